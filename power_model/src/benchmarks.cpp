@@ -11,6 +11,21 @@ int main(int, char**) {
     mb::BenchmarkSuite suite(mb::Target::AMD, mb::DataType::DOUBLE);
     suite.ConfigureDeviceSelection(1, mb::DeviceType::GPU);
     suite.ConfigureSleep(500, 0);
+    //suite.AddPowerSource("amd");
+    //suite.AddPowerSource("rapl", "", 1000);
+    //suite.AddPowerSource("hwmon", ",PPT");
+    //suite.ConfigureEnergyMode(mb::EnergyMode::COUNTER);
+    //suite.ConfigureSamplerThread(mb::ThreadPlacement({0}, 50));
+    //suite.ConfigurePowerAdaptive(50000, 5.0);
+    //suite.ConfigureSubmitThread(mb::ThreadPlacement({1}));
+    //suite.ConfigureCounterBackend("perf");
+    //suite.ConfigureCounterSampling(10);
+    //suite.ConfigureCounterCache("papi-events.cache");
+    //suite.ConfigureAllocation(mb::AllocationStrategy::SHARED_PREFETCH, 3); // 3: hipMemAdviseSetPreferredLocation
+    //suite.ConfigureVectorWidth(4);
+    //suite.ConfigureWorkGroup(256, 16384);
+    //suite.ConfigureSweep({64, 128, 256, 512, 1024}, {0, 16384, 32768, 65536});
+    //suite.ConfigureCounters({"rocm:::SQ_INSTS_VALU", "rocm:::SQ_INSTS_SALU", "rocm:::TCC_HIT_sum", "rocm:::TCC_MISS_sum", "rocm:::SQC_DCACHE_REQ"});
     
     suite.Run(mb::Benchmark::INFO);
     
@@ -19,6 +34,16 @@ int main(int, char**) {
     suite.WritePowerCsv(path + "/test_power.csv");
     suite.Print();
 
+    //suite.Run(mb::Benchmark::SAMPLER_PERTURBATION, 100000, 10000000);
+    //suite.Print();
+
+    //suite.Run(mb::Benchmark::ADD_LOCAL, 100000, 10000000);
+    //suite.Print();
+
+    //suite.ConfigureSweep({256}, {0}, {1, 2, 4, 8, 16, 32, 64, 128, 304});
+    //suite.Run(mb::Benchmark::OCCUPANCY, 100000, 100000);
+    //suite.Print();
+
     //suite.Run(mb::Benchmark::COPY, 100000, 10000000);
     //suite.Print();
 
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "power-wrappers/microbench-power-store.h"
+#include "power-wrappers/microbench-power-trace.h"
+
+using namespace std;
+
+void printUsage(){
+    cout << "Usage: mb-trace <command> <input> [output]" << endl;
+    cout << "\tinfo <trace>\t\tPrint the header of a binary or CSV power trace" << endl;
+    cout << "\tto-csv <mbt> <csv>\tConvert a binary trace to CSV" << endl;
+    cout << "\tto-binary <csv> <mbt>\tConvert a CSV trace to binary" << endl;
+}
+
+int info(string input){
+    if (mb::PowerTrace::IsTrace(input)){
+        mb::PowerTrace trace(input);
+        cout << "format: binary" << endl;
+        cout << "clock: " << trace.Clock() << endl;
+        cout << "samples: " << trace.SampleCount() << endl;
+        cout << "devices: " << trace.DeviceCount() << endl;
+        for (int i = 0; i < trace.DeviceCount(); i++) cout << "\t" << trace.DeviceName(i) << endl;
+        cout << "markers: " << trace.Markers().size() << endl;
+        if (trace.SampleCount() > 0){
+            cout << "duration: " << (trace.Timestamps()[trace.SampleCount() - 1] - trace.Timestamps()[0]) / 1000000000.0 << " s" << endl;
+        }
+    } else {
+        vector<string> names;
+        vector<mb::PowerMarker> markers;
+        mb::PowerStore store = mb::ReadPowerCsv(input, names, markers);
+        cout << "format: csv" << endl;
+        cout << "samples: " << store.Size() << endl;
+        cout << "devices: " << store.DeviceCount() << endl;
+        for (string const& name : names) cout << "\t" << name << endl;
+        cout << "markers: " << markers.size() << endl;
+        cout << "duration: " << store.Duration() << " s" << endl;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv){
+    if (argc < 3){
+        printUsage();
+        return 1;
+    }
+
+    string command = argv[1];
+    string input = argv[2];
+
+    if (command == "info"){
+        return info(input);
+    }
+    if (argc < 4){
+        printUsage();
+        return 1;
+    }
+    string output = argv[3];
+
+    if (command == "to-csv"){
+        mb::PowerTrace trace(input);
+        vector<string> names;
+        for (int i = 0; i < trace.DeviceCount(); i++) names.push_back(trace.DeviceName(i));
+        trace.ToStore().WriteCsv(output, names, trace.Markers());
+    } else if (command == "to-binary"){
+        // CSV traces do not record their clock, markers keep the timestamp of their sample
+        vector<string> names;
+        vector<mb::PowerMarker> markers;
+        mb::PowerStore store = mb::ReadPowerCsv(input, names, markers);
+        mb::PowerTrace::Write(output, store, names, "unknown", markers);
+    } else {
+        printUsage();
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include "microbench-counter-wrapper.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+
+using namespace mb;
+using namespace std;
+
+mb::ThreadCounters::ThreadCounters(vector<string> counter_names){
+    names = counter_names;
+}
+
+vector<long> mb::ThreadCounters::ProcessThreads(){
+    vector<long> threads;
+    for (auto const& entry : filesystem::directory_iterator("/proc/self/task")){
+        threads.push_back(stol(entry.path().filename().string()));
+    }
+    sort(threads.begin(), threads.end());
+    return threads;
+}
+
+void mb::ThreadCounters::Clear(){
+    tids.clear();
+    values.clear();
+}
+
+void mb::ThreadCounters::Add(long tid, const uint64_t* thread_values){
+    tids.push_back(tid);
+    values.insert(values.end(), thread_values, thread_values + names.size());
+}
+
+size_t mb::ThreadCounters::ThreadCount(){
+    return tids.size();
+}
+
+size_t mb::ThreadCounters::ActiveCount(){
+    size_t count = 0;
+    for (size_t t = 0; t < tids.size(); t++){
+        if (active(t)) count++;
+    }
+    return count;
+}
+
+uint64_t mb::ThreadCounters::Total(int counter){
+    uint64_t total = 0;
+    for (size_t t = 0; t < tids.size(); t++) total += values[t * names.size() + counter];
+    return total;
+}
+
+uint64_t mb::ThreadCounters::Max(int counter){
+    uint64_t max = 0;
+    for (size_t t = 0; t < tids.size(); t++) max = std::max(max, values[t * names.size() + counter]);
+    return max;
+}
+
+double mb::ThreadCounters::Imbalance(int counter){
+    double average = mean(counter);
+    return average > 0 ? Max(counter) / average : NAN;
+}
+
+double mb::ThreadCounters::Variation(int counter){
+    double average = mean(counter);
+    if (!(average > 0)) return NAN;
+
+    double m2 = 0.0;
+    for (size_t t = 0; t < tids.size(); t++){
+        if (!active(t)) continue;
+        double delta = values[t * names.size() + counter] - average;
+        m2 += delta * delta;
+    }
+    return sqrt(m2 / ActiveCount()) / average;
+}
+
+string mb::ThreadCounters::GetCsvHeader(){
+    string line_str = "threads,";
+    for (string const& name : names){
+        line_str += "THREAD_MAX:" + name + "," + "THREAD_IMBALANCE:" + name + "," + "THREAD_CV:" + name + ",";
+    }
+    return line_str;
+}
+
+string mb::ThreadCounters::GetCsvLine(){
+    string line_str = to_string(ActiveCount()) + ",";
+    for (size_t i = 0; i < names.size(); i++){
+        line_str += to_string(Max(i)) + "," + to_string(Imbalance(i)) + "," + to_string(Variation(i)) + ",";
+    }
+    return line_str;
+}
+
+void mb::ThreadCounters::Print(){
+    cout << "THREADS: " << ActiveCount() << " of " << ThreadCount() << " threads counted events" << endl;
+    for (size_t i = 0; i < names.size(); i++){
+        cout << "\t" << names[i] << ": total " << Total(i) << ", max " << Max(i) << ", imbalance " << Imbalance(i) << ", cv " << Variation(i) << endl;
+    }
+}
+
+void mb::ThreadCounters::WriteCsv(string path){
+    string buffer = "tid,";
+    for (string const& name : names) buffer += name + ",";
+    buffer.back() = '\n';
+
+    for (size_t t = 0; t < tids.size(); t++){
+        buffer += to_string(tids[t]);
+        for (size_t i = 0; i < names.size(); i++) buffer += "," + to_string(values[t * names.size() + i]);
+        buffer += "\n";
+    }
+
+    ofstream csv_file(path, ios_base::out | ios_base::binary);
+    csv_file.write(buffer.data(), buffer.size());
+}
+
+bool mb::ThreadCounters::active(size_t thread){
+    for (size_t i = 0; i < names.size(); i++){
+        if (values[thread * names.size() + i] > 0) return true;
+    }
+    return false;
+}
+
+double mb::ThreadCounters::mean(int counter){
+    size_t count = ActiveCount();
+    return count > 0 ? (double)Total(counter) / count : 0.0;
+}
+
+shared_ptr<CounterWrapper> mb::CounterWrapperRegistry::Create(string name, Target target){
+    if (name.empty()){
+        list<string> names = Names();
+        if (Contains("papi")) name = "papi";
+        else if (names.size() > 0) name = names.front();
+    }
+
+    if (!Contains(name)){
+        cout << "ERROR: The counter backend " << name << " is not available in this binary!" << endl;
+        exit(1);
+    }
+    return Registry::Create(name, target);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <iostream>
+#include <list>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+
+#include "power-wrappers/microbench-power-source.h"
+#include "power-wrappers/microbench-registry.h"
+
+namespace mb{
+    enum Target {AMD, NVIDIA, INTEL}; 
+
+    // Host counter values of every thread of the process for one run. The
+    // imbalance statistics only cover threads that counted any event.
+    class ThreadCounters{
+        public:
+            ThreadCounters(std::vector<std::string> names = {});
+
+            // Thread ids of this process from /proc/self/task
+            static std::vector<long> ProcessThreads();
+
+            void Clear();
+            void Add(long tid, const uint64_t* values);
+
+            size_t ThreadCount();
+            size_t ActiveCount();
+            uint64_t Total(int counter);
+            uint64_t Max(int counter);
+
+            // Max over mean of the active threads, 1 for a perfectly balanced run
+            double Imbalance(int counter);
+
+            // Coefficient of variation (std / mean) of the active threads
+            double Variation(int counter);
+
+            std::string GetCsvHeader();
+            std::string GetCsvLine();
+            void Print();
+
+            // One line per thread: tid and its counter values
+            void WriteCsv(std::string path);
+
+        private:
+            std::vector<std::string> names;
+            std::vector<long> tids;
+            std::vector<uint64_t> values;
+
+            bool active(size_t thread);
+            double mean(int counter);
+    };
+
+    // Hardware event counters around a benchmark run (PAPI, perf_event, ...). All
+    // backends write the same host columns, so the CSV schema does not depend on
+    // the backend. As a CounterSource the counters can be read by the power sampler.
+    class CounterWrapper : public CounterSource{
+        public:
+            virtual ~CounterWrapper(){}
+
+            virtual void Start() = 0;
+            virtual void Stop() = 0;
+            virtual void Print() = 0;
+
+            virtual std::string GetCsvHeader() = 0;
+            virtual std::string GetCsvLine() = 0;
+
+            virtual void ConfigureDevices(std::list<int> device_ids) = 0;
+
+            // Count these event bases (e.g. "rocm:::SQ_INSTS") on every device
+            // instead of the predefined event set selection
+            virtual void ConfigureDeviceEvents(std::list<std::string> event_bases) = 0;
+
+            // Number of passes needed for all device events
+            virtual int PassCount(){
+                return 1;
+            }
+
+            // Pass counted by the next Start(), merged results restart at pass 0
+            virtual void ConfigurePass(int){}
+
+            // Count the host events on every thread present at Start() (e.g. the workers
+            // of a SYCL CPU device) instead of the calling thread. The host columns then
+            // hold the totals over all threads, followed by the imbalance statistics.
+            virtual void ConfigureThreads(bool per_thread) = 0;
+            virtual void WriteThreadCsv(std::string path) = 0;
+
+            // File caching the events available on this machine, for backends that
+            // have to probe them
+            virtual void ConfigureEventCache(std::string){}
+    };
+
+    // Backend names ("papi", "perf") of the counter wrappers, registered as for the power sources
+    class CounterWrapperRegistry : public Registry<CounterWrapper, Target>{
+        public:
+            // An empty name prefers papi and falls back to any other linked backend,
+            // exits if the backend is not linked into the binary
+            static std::shared_ptr<CounterWrapper> Create(std::string name, Target target);
+    };
+
+    typedef CounterWrapperRegistry::Registration CounterWrapperRegistration;
+}
\ No newline at end of file
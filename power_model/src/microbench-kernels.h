@@ -0,0 +1,228 @@
+#pragma once
+
+#include <sycl/sycl.hpp>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mb{
+    // Compile-time composition of the arithmetic benchmarks. Every operation of a mix
+    // assigns an expression of the arrays a-d and a scalar to a[i], e.g.
+    //
+    //     Ops<Add<B, C>, Triad<A, B>, Sin<C>>
+    //
+    // A kernel runs the mix Unroll times per loop iteration (expanded at compile time)
+    // and loops n times per element. Only the arrays read by the mix are allocated.
+    // The elements are T or sycl::vec<T, N>, the scalar is always T.
+
+    // Operands, the mask tells which arrays (and the scalar) a mix reads
+    struct A{
+        static constexpr unsigned Mask = 1;
+        template<typename V> static auto Eval(V const& v, size_t i){ return v.a[i]; }
+    };
+
+    struct B{
+        static constexpr unsigned Mask = 2;
+        template<typename V> static auto Eval(V const& v, size_t i){ return v.b[i]; }
+    };
+
+    struct C{
+        static constexpr unsigned Mask = 4;
+        template<typename V> static auto Eval(V const& v, size_t i){ return v.c[i]; }
+    };
+
+    struct D{
+        static constexpr unsigned Mask = 8;
+        template<typename V> static auto Eval(V const& v, size_t i){ return v.d[i]; }
+    };
+
+    struct Scalar{
+        static constexpr unsigned Mask = 16;
+        template<typename V> static auto Eval(V const& v, size_t){ return v.scalar; }
+    };
+
+    // Lane type of a vector width, width 1 is the plain scalar kernel
+    template<typename T, int N>
+    struct Lanes{
+        typedef sycl::vec<T, N> Type;
+    };
+
+    template<typename T>
+    struct Lanes<T, 1>{
+        typedef T Type;
+    };
+
+    // Math function on a scalar or on all lanes of a vector. sycl::vec only has them for
+    // floating point lanes, integer vectors go through float as scalar ints go through double.
+    template<typename X, typename F>
+    inline auto applyMath(X x, F f){
+        return f(x);
+    }
+
+    template<typename T, int N, typename F>
+    inline sycl::vec<T, N> applyMath(sycl::vec<T, N> x, F f){
+        if constexpr (std::is_integral_v<T>){
+            return f(x.template convert<float>()).template convert<T>();
+        } else {
+            return f(x);
+        }
+    }
+
+    // Operations
+    template<typename X, typename Y>
+    struct Add{
+        static constexpr unsigned Mask = X::Mask | Y::Mask;
+        template<typename V> static auto Eval(V const& v, size_t i){ return X::Eval(v, i) + Y::Eval(v, i); }
+    };
+
+    template<typename X, typename Y>
+    struct Mul{
+        static constexpr unsigned Mask = X::Mask | Y::Mask;
+        template<typename V> static auto Eval(V const& v, size_t i){ return X::Eval(v, i) * Y::Eval(v, i); }
+    };
+
+    // x + y * z
+    template<typename X, typename Y, typename Z>
+    struct Fma{
+        static constexpr unsigned Mask = X::Mask | Y::Mask | Z::Mask;
+        template<typename V> static auto Eval(V const& v, size_t i){ return X::Eval(v, i) + Y::Eval(v, i) * Z::Eval(v, i); }
+    };
+
+    // std overloads for scalars (float stays float), sycl:: ones found by ADL for vectors
+    template<typename X>
+    struct Sin{
+        static constexpr unsigned Mask = X::Mask;
+        template<typename V> static auto Eval(V const& v, size_t i){ return applyMath(X::Eval(v, i), [](auto x){ using std::sin; return sin(x); }); }
+    };
+
+    template<typename X>
+    struct Log{
+        static constexpr unsigned Mask = X::Mask;
+        template<typename V> static auto Eval(V const& v, size_t i){ return applyMath(X::Eval(v, i), [](auto x){ using std::log; return log(x); }); }
+    };
+
+    template<typename X>
+    struct Sqrt{
+        static constexpr unsigned Mask = X::Mask;
+        template<typename V> static auto Eval(V const& v, size_t i){ return applyMath(X::Eval(v, i), [](auto x){ using std::sqrt; return sqrt(x); }); }
+    };
+
+    // x + scalar * y and scalar * x as in STREAM
+    template<typename X, typename Y> using Triad = Fma<X, Scalar, Y>;
+    template<typename X> using Scale = Mul<Scalar, X>;
+
+    // Mix of operations, applied in order
+    template<typename... Op>
+    struct Ops{
+        static constexpr unsigned Mask = (A::Mask | ... | Op::Mask);
+
+        template<typename V>
+        static void Apply(V const& v, size_t i){
+            ((v.a[i] = Op::Eval(v, i)), ...);
+        }
+    };
+
+    template<typename O, typename V, int... Is>
+    inline void applyUnrolled(V const& v, size_t i, std::integer_sequence<int, Is...>){
+        (((void)Is, O::Apply(v, i)), ...);
+    }
+
+    // The mix repeated Unroll times without a loop
+    template<typename O, int Unroll, typename V>
+    inline void ApplyUnrolled(V const& v, size_t i){
+        applyUnrolled<O>(v, i, std::make_integer_sequence<int, Unroll>());
+    }
+
+    // Value ranges of the initial b, c and d arrays (a starts at zero)
+    template<int Min, int Max>
+    struct Range{
+        static constexpr int Lower = Min;
+        static constexpr int Upper = Max;
+    };
+
+    template<typename RB = Range<1, 2>, typename RC = Range<2, 4>, typename RD = Range<4, 10>>
+    struct Inputs{
+        typedef RB RangeB;
+        typedef RC RangeC;
+        typedef RD RangeD;
+    };
+
+    // What a kernel body sees: the arrays (USM pointers or buffer accessors) and the scalar
+    template<typename T, typename P>
+    struct KernelView{
+        P a, b, c, d;
+        T scalar;
+    };
+
+    // Arrays of one benchmark run with elements of type V (T or sycl::vec<T, N>), in USM
+    // or in SYCL buffers depending on the allocation strategy
+    template<typename T, typename V = T>
+    class KernelArrays{
+        public:
+            V* Pointers[4] = {nullptr, nullptr, nullptr, nullptr};
+            std::vector<sycl::buffer<V, 1>> Buffers;
+            T Scalar = 0;
+            size_t Count = 0;
+
+            // Work-group size of Kernel, 0 leaves it to the runtime
+            size_t WorkGroup = 0;
+
+            // Command group running body(view, i) on every element
+            template<typename F>
+            auto Kernel(F body){
+                return [this, body](sycl::handler& h){
+                    size_t count = Count;
+                    size_t group = WorkGroup;
+                    withView(h, [&](auto const& view){
+                        if (group == 0){
+                            h.parallel_for(count, [=](sycl::id<1> i){ body(view, i); });
+                        } else {
+                            // The global range is rounded up to whole work-groups
+                            h.parallel_for(sycl::nd_range<1>(globalRange(group), group), [=](sycl::nd_item<1> item){
+                                size_t i = item.get_global_id(0);
+                                if (i < count) body(view, i);
+                            });
+                        }
+                    });
+                };
+            }
+
+            // Command group running body(view, item, tile) in work-groups of the given size with a
+            // local tile of tileCount elements. Work-items past the last element run as well (barriers),
+            // the body has to check the global id.
+            template<typename F>
+            auto GroupKernel(size_t group, size_t tileCount, F body){
+                return GroupKernel(globalRange(group) / group, group, tileCount, body);
+            }
+
+            // As above with a fixed number of work-groups, e.g. persistent work-groups striding over the elements
+            template<typename F>
+            auto GroupKernel(size_t groups, size_t group, size_t tileCount, F body){
+                return [this, groups, group, tileCount, body](sycl::handler& h){
+                    sycl::local_accessor<V, 1> tile(sycl::range<1>(tileCount), h);
+                    withView(h, [&](auto const& view){
+                        h.parallel_for(sycl::nd_range<1>(groups * group, group), [=](sycl::nd_item<1> item){
+                            body(view, item, tile);
+                        });
+                    });
+                };
+            }
+
+        private:
+            size_t globalRange(size_t group){
+                return (Count + group - 1) / group * group;
+            }
+
+            // Calls launch(view) with the USM pointers or the buffer accessors
+            template<typename F>
+            void withView(sycl::handler& h, F launch){
+                if (Buffers.empty()){
+                    launch(KernelView<T, V*>{Pointers[0], Pointers[1], Pointers[2], Pointers[3], Scalar});
+                } else {
+                    typedef sycl::accessor<V, 1, sycl::access::mode::read_write> Accessor;
+                    launch(KernelView<T, Accessor>{Accessor(Buffers[0], h), Accessor(Buffers[1], h), Accessor(Buffers[2], h), Accessor(Buffers[3], h), Scalar});
+                }
+            }
+    };
+}
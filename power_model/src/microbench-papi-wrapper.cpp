@@ -2,51 +2,298 @@
 #include <iostream>
 #include <papi.h>
 #include <list>
+#include <utility>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
 
 using namespace mb;
 using namespace std;
 
-mb::PapiWrapper::PapiWrapper(){}
+static CounterWrapperRegistration registration("papi", [](Target target){
+    return (shared_ptr<CounterWrapper>)make_shared<PapiWrapper>(target);
+});
 
-mb::PapiWrapper::PapiWrapper(Target t, list<int> device_ids, int event_set){
+mb::PapiSession& mb::PapiSession::Get(){
+    static PapiSession session;
+    return session;
+}
+
+mb::PapiSession::PapiSession(){
+    int retval = PAPI_library_init(PAPI_VER_CURRENT);
+    if (retval != PAPI_VER_CURRENT){
+        std::cout << "PAPI Error: " << retval << std::endl;
+        exit(1);
+    }
+    cache_path = "papi-events.cache";
+    probed = false;
+}
+
+bool mb::PapiSession::HasComponent(string name){
+    for (int i = 0; i < PAPI_num_components(); i++){
+        const PAPI_component_info_t* info = PAPI_get_component_info(i);
+        if (info != nullptr && info->name == name) return !info->disabled;
+    }
+    return false;
+}
+
+bool mb::PapiSession::HasEvent(string event){
+    if (!probed){
+        string key = cacheKey();
+        if (!readCache(key)){
+            probeEvents();
+            writeCache(key);
+        }
+        probed = true;
+    }
+    if (events.count(event) > 0) return true;
+
+    // Components list the base names, qualifiers (e.g. :device=0) come after them
+    size_t start = event.rfind("::");
+    start = start == string::npos ? 0 : start + 2;
+    return events.count(event.substr(0, event.find(':', start))) > 0;
+}
+
+void mb::PapiSession::ConfigureEventCache(string path){
+    if (path == cache_path) return;
+    cache_path = path;
+    probed = false;
+}
+
+string mb::PapiSession::cacheKey(){
+    // Another PAPI, driver (component version) or device (native event count) invalidates the cache
+    string key = "papi=" + to_string(PAPI_VER_CURRENT);
+    for (int i = 0; i < PAPI_num_components(); i++){
+        const PAPI_component_info_t* info = PAPI_get_component_info(i);
+        if (info == nullptr || info->disabled) continue;
+        key += string(" ") + info->name + "=" + info->version + "/" + to_string(info->num_native_events);
+    }
+    return key;
+}
+
+bool mb::PapiSession::readCache(string key){
+    ifstream cache_file(cache_path);
+    string line;
+    if (!getline(cache_file, line) || line != key) return false;
+
+    events.clear();
+    while (getline(cache_file, line)){
+        if (!line.empty()) events.insert(line);
+    }
+    return true;
+}
+
+void mb::PapiSession::writeCache(string key){
+    ofstream cache_file(cache_path);
+    if (!cache_file){
+        cout << "WARNING: Cannot write the PAPI event cache " << cache_path << ", the events are probed again next time!" << endl;
+        return;
+    }
+    cache_file << key << "\n";
+    for (string const& event : events) cache_file << event << "\n";
+}
+
+void mb::PapiSession::probeEvents(){
+    cout << "Probing the available PAPI events..." << endl;
+    events.clear();
+    char name[PAPI_MAX_STR_LEN];
+
+    // Presets that map to counters of this CPU
+    int code = PAPI_PRESET_MASK;
+    if (PAPI_enum_event(&code, PAPI_ENUM_FIRST) == PAPI_OK){
+        do {
+            if (PAPI_query_event(code) == PAPI_OK && PAPI_event_code_to_name(code, name) == PAPI_OK) events.insert(name);
+        } while (PAPI_enum_event(&code, PAPI_PRESET_ENUM_AVAIL) == PAPI_OK);
+    }
+
+    // Native events of every enabled component (e.g. rocm, perf_event)
+    for (int i = 0; i < PAPI_num_components(); i++){
+        const PAPI_component_info_t* info = PAPI_get_component_info(i);
+        if (info == nullptr || info->disabled) continue;
+
+        code = PAPI_NATIVE_MASK;
+        if (PAPI_enum_cmp_event(&code, PAPI_ENUM_FIRST, i) != PAPI_OK) continue;
+        do {
+            if (PAPI_event_code_to_name(code, name) == PAPI_OK) events.insert(name);
+        } while (PAPI_enum_cmp_event(&code, PAPI_ENUM_EVENTS, i) == PAPI_OK);
+    }
+}
+
+mb::PapiWrapper::PapiWrapper(){
+    initialized = false;
+    host_eventset = PAPI_NULL;
+    current_pass = 0;
+    event_set_selection = 0;
+    per_thread = false;
+}
+
+mb::PapiWrapper::PapiWrapper(Target t, list<int> device_ids, int event_set) : PapiWrapper(){
     target = t;
     event_set_selection = event_set;
     
     if (target == Target::AMD) initAmd();
     else exit(1);
 
+    // Define host events
+    host_events = {
+        PAPI_TOT_INS,
+        PAPI_FP_INS,
+        PAPI_BR_INS,
+        PAPI_VEC_INS,
+        PAPI_TOT_CYC
+    };
+    host_counters.assign(host_events.size(), 0);
+    thread_values.assign(host_events.size(), 0);
+
+    // Preset names need the library
+    PapiSession::Get();
+    vector<string> names;
+    for (int const& event : host_events) names.push_back(getEventName(event));
+    thread_counters = ThreadCounters(names);
+
     ConfigureDevices(device_ids);
-    initPapi();
+}
+
+mb::PapiWrapper::~PapiWrapper(){
+    releasePapi();
+}
+
+mb::PapiWrapper::PapiWrapper(PapiWrapper&& other) : PapiWrapper(){
+    *this = std::move(other);
+}
+
+mb::PapiWrapper& mb::PapiWrapper::operator=(PapiWrapper&& other){
+    releasePapi();
+
+    target = other.target;
+    initialized = other.initialized;
+    host_eventset = other.host_eventset;
+    host_events = std::move(other.host_events);
+    host_counters = std::move(other.host_counters);
+    host_columns = std::move(other.host_columns);
+    host_values = std::move(other.host_values);
+    per_thread = other.per_thread;
+    thread_eventsets = std::move(other.thread_eventsets);
+    thread_values = std::move(other.thread_values);
+    thread_counters = std::move(other.thread_counters);
+    device_events = std::move(other.device_events);
+    device_eventsets = std::move(other.device_eventsets);
+    pass_columns = std::move(other.pass_columns);
+    pass_counters = std::move(other.pass_counters);
+    current_pass = other.current_pass;
+    read_counters = std::move(other.read_counters);
+    counter_sum = std::move(other.counter_sum);
+    counter_sum2 = std::move(other.counter_sum2);
+    counter_passes = std::move(other.counter_passes);
+    device_event_sets = std::move(other.device_event_sets);
+    event_set_selection = other.event_set_selection;
+    device_event_bases = std::move(other.device_event_bases);
+    devices = std::move(other.devices);
+
+    // The event sets now belong to this wrapper
+    other.initialized = false;
+    other.host_eventset = PAPI_NULL;
+    other.device_eventsets.clear();
+    other.thread_eventsets.clear();
+    return *this;
 }
 
 void mb::PapiWrapper::Start() {    
-    initPapi();
-    handleReturn(PAPI_start(host_eventset));
+    if (!initialized) initPapi();
+    if (current_pass == 0) clearCounters();
+
+    // Not every component zeroes its counters on start
+    int device_eventset = device_eventsets[current_pass];
+    if (host_eventset != PAPI_NULL) handleReturn(PAPI_reset(host_eventset));
+    handleReturn(PAPI_reset(device_eventset));
+    if (host_eventset != PAPI_NULL) handleReturn(PAPI_start(host_eventset));
     handleReturn(PAPI_start(device_eventset));
+
+    if (per_thread){
+        updateThreadEventsets();
+        for (auto const& [tid, eventset] : thread_eventsets){
+            handleReturn(PAPI_reset(eventset));
+            handleReturn(PAPI_start(eventset));
+        }
+    }
 }
 
 void mb::PapiWrapper::Stop() {
-    // cout << "Stop" << endl;
-    handleReturn(PAPI_stop(host_eventset, host_counters));
-    handleReturn(PAPI_stop(device_eventset, device_counters));
-    handleReturn(PAPI_cleanup_eventset(host_eventset));
-    handleReturn(PAPI_cleanup_eventset(device_eventset));
+    if (host_eventset != PAPI_NULL) handleReturn(PAPI_stop(host_eventset, host_values.data()));
+    handleReturn(PAPI_stop(device_eventsets[current_pass], pass_counters[current_pass].data()));
+    for (size_t i = 0; i < host_columns.size(); i++) host_counters[host_columns[i]] = host_values[i];
+
+    // Host columns are the totals over all threads instead of the calling thread
+    if (per_thread){
+        thread_counters.Clear();
+        vector<uint64_t> values(host_events.size());
+        for (auto const& [tid, eventset] : thread_eventsets){
+            // Threads that finished during the run cannot be read anymore
+            if (PAPI_stop(eventset, thread_values.data()) != PAPI_OK) continue;
+            for (size_t i = 0; i < host_columns.size(); i++) values[host_columns[i]] = thread_values[i];
+            thread_counters.Add(tid, values.data());
+        }
+        for (size_t i = 0; i < host_counters.size(); i++) host_counters[i] = thread_counters.Total(i);
+    }
+
+    // Fold this pass into the merged counters, skipped events keep zero passes
+    for (int i : host_columns){
+        counter_sum[i] += host_counters[i];
+        counter_sum2[i] += (double)host_counters[i] * host_counters[i];
+        counter_passes[i]++;
+    }
+    vector<int>& columns = pass_columns[current_pass];
+    for (size_t i = 0; i < columns.size(); i++){
+        double value = pass_counters[current_pass][i];
+        counter_sum[columns[i]] += value;
+        counter_sum2[columns[i]] += value * value;
+        counter_passes[columns[i]]++;
+    }
+}
+
+int mb::PapiWrapper::CounterCount(){
+    if (!initialized) initPapi();
+    return host_events.size() + pass_columns[current_pass].size();
+}
+
+string mb::PapiWrapper::CounterName(int counter){
+    if (counter < (int)host_events.size()) return getEventName(*next(host_events.begin(), counter));
+    int column = pass_columns[current_pass][counter - host_events.size()] - host_events.size();
+    return *next(device_events.begin(), column);
+}
+
+void mb::PapiWrapper::Read(uint64_t* values){
+    // Both sets were started by the submitting thread, PAPI is not initialized for
+    // threads, so the sampler thread reads them through the same process context
+    size_t host_count = host_events.size();
+    if (host_eventset != PAPI_NULL) handleReturn(PAPI_read(host_eventset, host_values.data()));
+    for (size_t i = 0; i < host_columns.size(); i++) read_counters[host_columns[i]] = host_values[i];
+    handleReturn(PAPI_read(device_eventsets[current_pass], read_counters.data() + host_count));
+
+    size_t count = host_count + pass_columns[current_pass].size();
+    for (size_t i = 0; i < count; i++) values[i] = read_counters[i];
 }
 
 void mb::PapiWrapper::Print(){
+    bool passes = device_eventsets.size() > 1;
+
     // Print Host Counter to Console            
     cout << "HOST COUNTERS:" << endl;
     int i = 0;
     for (int const& event : host_events) {
-        cout << "\t" << getEventName(event) << ": " << host_counters[i] << endl;       
+        cout << "\t" << getEventName(event) << ": " << getMeanString(i);
+        if (passes) cout << " (var " << getVariance(i) << ")";
+        cout << endl;
         i += 1; 
     }
+    if (per_thread) thread_counters.Print();
 
     // Print Device Counter to Console
     cout << "DEVICE COUNTERS:" << endl;
-    i = 0;
+    if (passes) cout << "\tPASSES: " << device_eventsets.size() << endl;
     for (string const& event : device_events) {
-        cout << "\t" << event << ": " << device_counters[i] << endl;       
+        cout << "\t" << event << ": " << getMeanString(i) << endl;
         i += 1; 
     }
 }
@@ -63,45 +310,100 @@ string mb::PapiWrapper::GetCsvHeader(){
         line_str += event + ",";
     }
 
+    // Spread of the host counters across the passes, every device event is counted in one pass only
+    if (device_eventsets.size() > 1){
+        for (int const& event : host_events) {
+            line_str += "VAR:" + getEventName(event) + ",";
+        }
+    }
+
+    if (per_thread) line_str += thread_counters.GetCsvHeader();
     return line_str;
 }
 
 string mb::PapiWrapper::GetCsvLine(){           
     string line_str = "";
 
-    int i = 0;
-    for (int const& event : host_events) {
-        line_str += to_string(host_counters[i]) + ",";        
-        i += 1; 
+    int columns = host_events.size() + device_events.size();
+    for (int i = 0; i < columns; i++) {
+        line_str += (counter_passes[i] > 0 ? to_string((long_long)getMean(i)) : "") + ",";
     }
 
-    i = 0;
-    for (string const& event : device_events) {
-        line_str += to_string(device_counters[i]) + ",";                
-        i += 1; 
+    if (device_eventsets.size() > 1){
+        for (size_t i = 0; i < host_events.size(); i++) {
+            line_str += (counter_passes[i] > 0 ? to_string(getVariance(i)) : "") + ",";
+        }
     }
 
+    if (per_thread) line_str += thread_counters.GetCsvLine();
     return line_str;
 }
 
 void mb::PapiWrapper::ConfigureDevices(std::list<int> device_ids){
+    // The device events change, the event sets are recreated on the next Start()
+    releasePapi();
     devices = device_ids;
 
-    // Check if event set is available
-    if (event_set_selection >= device_event_sets.size()){
-        cout << "ERROR: There is no event set available for the selection!" << endl;
-        exit(1);
+    // Explicit events take precedence over the predefined selection
+    list<string> event_bases = device_event_bases;
+    if (event_bases.empty()){
+        // Check if event set is available
+        size_t selection = (size_t)event_set_selection;
+        if (event_set_selection < 0 || selection >= device_event_sets.size()){
+            cout << "ERROR: There is no event set available for the selection!" << endl;
+            exit(1);
+        }
+        event_bases = *next(device_event_sets.begin(), selection);
     }
     
     // Create events based on selection
     device_events.clear();
-    list<string> event_bases = *next(device_event_sets.begin(), event_set_selection);
     for (int device : devices){
         for (string event_base : event_bases) {
             auto ev = event_base + ":device=" + to_string(device);            
             device_events.push_back(ev);
         }
     }
+
+    // Allocate space for results once, every run stops into the same storage
+    size_t columns = host_events.size() + device_events.size();
+    counter_sum.assign(columns, 0.0);
+    counter_sum2.assign(columns, 0.0);
+    counter_passes.assign(columns, 0);
+}
+
+void mb::PapiWrapper::ConfigureDeviceEvents(std::list<std::string> event_bases){
+    device_event_bases = event_bases;
+    ConfigureDevices(devices);
+}
+
+void mb::PapiWrapper::ConfigureThreads(bool enabled){
+    per_thread = enabled;
+    if (!per_thread){
+        for (auto& [tid, eventset] : thread_eventsets) releaseThreadEventset(eventset);
+        thread_eventsets.clear();
+    }
+}
+
+void mb::PapiWrapper::WriteThreadCsv(std::string path){
+    thread_counters.WriteCsv(path);
+}
+
+void mb::PapiWrapper::ConfigureEventCache(std::string path){
+    PapiSession::Get().ConfigureEventCache(path);
+}
+
+int mb::PapiWrapper::PassCount(){
+    if (!initialized) initPapi();
+    return device_eventsets.size();
+}
+
+void mb::PapiWrapper::ConfigurePass(int pass){
+    if (pass < 0 || pass >= PassCount()){
+        cout << "ERROR: There is no counter pass " << pass << "!" << endl;
+        exit(1);
+    }
+    current_pass = pass;
 }
 
 void mb::PapiWrapper::initAmd(){
@@ -161,47 +463,188 @@ void mb::PapiWrapper::initAmd(){
 
 void mb::PapiWrapper::initPapi(){
     // Initialize events
-    handleReturn(PAPI_library_init(PAPI_VER_CURRENT));
+    if (target == Target::AMD && !PapiSession::Get().HasComponent("rocm")){
+        cout << "PAPI Error: The rocm component is not available!" << endl;
+        exit(1);
+    }
     
     initHostEventset();    
-    initDeviceEventset();
+    initDeviceEventsets();
+    current_pass = 0;
+    initialized = true;
+}
+
+void mb::PapiWrapper::releasePapi(){
+    if (!initialized) return;
+
+    // Best effort, also called from the destructor
+    if (host_eventset != PAPI_NULL){
+        PAPI_cleanup_eventset(host_eventset);
+        PAPI_destroy_eventset(&host_eventset);
+    }
+    for (int& eventset : device_eventsets){
+        PAPI_cleanup_eventset(eventset);
+        PAPI_destroy_eventset(&eventset);
+    }
+    for (auto& [tid, eventset] : thread_eventsets) releaseThreadEventset(eventset);
+    host_eventset = PAPI_NULL;
+    device_eventsets.clear();
+    thread_eventsets.clear();
+    initialized = false;
 }
 
 void mb::PapiWrapper::initHostEventset(){
+    // Only events this CPU can count, the others keep an empty column
+    host_columns.clear();
+    int column = 0;
+    for (int const& event : host_events) {
+        if (PapiSession::Get().HasEvent(getEventName(event))) host_columns.push_back(column);
+        else cout << "WARNING: The host event " << getEventName(event) << " is not available, skipping it!" << endl;
+        column++;
+    }
+    host_values.assign(host_columns.size(), 0);
+    thread_values.assign(host_columns.size(), 0);
+
     // Initialize event set
     host_eventset = PAPI_NULL;
+    if (host_columns.empty()) return;
     handleReturn(PAPI_create_eventset(&host_eventset));
 
-    // Define host events
-    host_events = {
-        PAPI_TOT_INS,
-        PAPI_FP_INS,
-        PAPI_BR_INS,
-        PAPI_VEC_INS,
-        PAPI_TOT_CYC
-    };
-
     // Add events to set
-    for (int const& event : host_events) {
-        handleReturn(PAPI_add_event(host_eventset, event));
+    for (int column : host_columns) {
+        handleReturn(PAPI_add_event(host_eventset, *next(host_events.begin(), column)));
     }
-    
-    // Allocate space for results
-    host_counters = new long_long[host_events.size()]();
 }
 
-void mb::PapiWrapper::initDeviceEventset(){
-    // Initialize event set
-    device_eventset = PAPI_NULL;
-    handleReturn(PAPI_create_eventset(&device_eventset));
+void mb::PapiWrapper::updateThreadEventsets(){
+    vector<long> threads = ThreadCounters::ProcessThreads();
 
-    // Add events to set
-    for (string const& event : device_events) {        
-        handleReturn(PAPI_add_named_event(device_eventset, event.c_str()));                        
+    // Sets of finished threads are released, new threads get a set attached to them
+    for (auto it = thread_eventsets.begin(); it != thread_eventsets.end();){
+        if (!binary_search(threads.begin(), threads.end(), it->first)){
+            releaseThreadEventset(it->second);
+            it = thread_eventsets.erase(it);
+        } else {
+            it++;
+        }
     }
-    
-    // Allocate space for results
-    device_counters = new long_long[device_events.size()]();
+
+    for (long tid : threads){
+        if (thread_eventsets.count(tid) > 0) continue;
+
+        // Attaching needs the set bound to the CPU component before any event is added
+        int eventset = PAPI_NULL;
+        bool attached = PAPI_create_eventset(&eventset) == PAPI_OK
+            && PAPI_assign_eventset_component(eventset, 0) == PAPI_OK
+            && PAPI_attach(eventset, tid) == PAPI_OK;
+        for (int column : host_columns){
+            attached = attached && PAPI_add_event(eventset, *next(host_events.begin(), column)) == PAPI_OK;
+        }
+
+        if (!attached){
+            cout << "WARNING: Cannot attach the host events to thread " << tid << ", skipping the thread!" << endl;
+            releaseThreadEventset(eventset);
+            continue;
+        }
+        thread_eventsets[tid] = eventset;
+    }
+}
+
+void mb::PapiWrapper::releaseThreadEventset(int& eventset){
+    if (eventset == PAPI_NULL) return;
+    PAPI_cleanup_eventset(eventset);
+    PAPI_destroy_eventset(&eventset);
+}
+
+void mb::PapiWrapper::initDeviceEventsets(){
+    device_eventsets.clear();
+    pass_columns.clear();
+
+    // First fit: every event joins the first pass it is compatible with
+    int column = host_events.size();
+    for (string const& event : device_events) {
+        // Events of another GPU generation must not end a whole sweep, their columns stay empty
+        if (!PapiSession::Get().HasEvent(event)){
+            cout << "WARNING: The event " << event << " is not available on this device, skipping it!" << endl;
+            column++;
+            continue;
+        }
+
+        size_t pass = 0;
+        while (pass < device_eventsets.size() && !tryAddEvent(device_eventsets[pass], event)) pass++;
+
+        if (pass == device_eventsets.size()){
+            // Initialize event set
+            int eventset = PAPI_NULL;
+            handleReturn(PAPI_create_eventset(&eventset));
+
+            if (!tryAddEvent(eventset, event)){
+                cout << "WARNING: The event " << event << " cannot be counted, skipping it!" << endl;
+                PAPI_cleanup_eventset(eventset);
+                PAPI_destroy_eventset(&eventset);
+                column++;
+                continue;
+            }
+            device_eventsets.push_back(eventset);
+            pass_columns.push_back({});
+        }
+        pass_columns[pass].push_back(column);
+        column++;
+    }
+
+    // A pass without device events still counts the host events
+    if (device_eventsets.size() == 0){
+        int eventset = PAPI_NULL;
+        handleReturn(PAPI_create_eventset(&eventset));
+        device_eventsets.push_back(eventset);
+        pass_columns.push_back({});
+    }
+
+    // Allocate space for results once, every run stops into the same storage
+    pass_counters.clear();
+    size_t largest_pass = 0;
+    for (vector<int> const& columns : pass_columns){
+        pass_counters.push_back(vector<long_long>(columns.size(), 0));
+        largest_pass = max(largest_pass, columns.size());
+    }
+    read_counters.assign(host_events.size() + largest_pass, 0);
+
+    if (device_eventsets.size() > 1){
+        cout << "PAPI: " << device_events.size() << " device events need " << device_eventsets.size() << " passes" << endl;
+    }
+}
+
+bool mb::PapiWrapper::tryAddEvent(int eventset, string event){
+    if (PAPI_add_named_event(eventset, event.c_str()) != PAPI_OK) return false;
+
+    // Some conflicts only show up when the counters are programmed
+    vector<long_long> values(PAPI_num_events(eventset), 0);
+    if (PAPI_start(eventset) == PAPI_OK && PAPI_stop(eventset, values.data()) == PAPI_OK) return true;
+
+    PAPI_remove_named_event(eventset, event.c_str());
+    return false;
+}
+
+void mb::PapiWrapper::clearCounters(){
+    fill(counter_sum.begin(), counter_sum.end(), 0.0);
+    fill(counter_sum2.begin(), counter_sum2.end(), 0.0);
+    fill(counter_passes.begin(), counter_passes.end(), 0);
+}
+
+double mb::PapiWrapper::getMean(int column){
+    return counter_passes[column] > 0 ? counter_sum[column] / counter_passes[column] : 0.0;
+}
+
+string mb::PapiWrapper::getMeanString(int column){
+    return counter_passes[column] > 0 ? to_string((long_long)getMean(column)) : "not counted";
+}
+
+double mb::PapiWrapper::getVariance(int column){
+    // Population variance across the passes, undefined for counters of a single pass
+    int passes = counter_passes[column];
+    if (passes < 2) return NAN;
+    double mean = counter_sum[column] / passes;
+    return max(counter_sum2[column] / passes - mean * mean, 0.0);
 }
 
 void mb::PapiWrapper::handleReturn(int retval){
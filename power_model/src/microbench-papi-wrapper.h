@@ -2,15 +2,74 @@
 
 #include <papi.h>
 #include <list>
+#include <vector>
+#include <map>
+#include <set>
 #include <iostream>
 
+#include "microbench-counter-wrapper.h"
+
 namespace mb{
-    enum Target {AMD, NVIDIA, INTEL}; 
+    // Process-wide PAPI state. The library and its components are initialized
+    // on first use and stay initialized for all wrappers and runs.
+    class PapiSession{
+        public:
+            static PapiSession& Get();
+
+            // True if the component (e.g. "rocm") is compiled in and enabled
+            bool HasComponent(std::string name);
+
+            // True if an enabled component lists the event (qualifiers like :device=0
+            // are ignored). The available events are enumerated once and cached in a
+            // file per PAPI and component version, later processes only read the file.
+            bool HasEvent(std::string event);
+            void ConfigureEventCache(std::string path);
 
-    class PapiWrapper{
+        private:
+            PapiSession();
+
+            std::string cache_path;
+            bool probed;
+            std::set<std::string> events;
+
+            std::string cacheKey();
+            bool readCache(std::string key);
+            void writeCache(std::string key);
+            void probeEvents();
+    };
+
+    // The event sets are created on the first Start() and reused by every later
+    // run, Start() only resets and starts them. They are released when the
+    // device selection changes or the wrapper is destroyed.
+    //
+    // Device events that cannot be counted together are planned into passes:
+    // every event goes into the first pass it is compatible with (probed by
+    // adding it and starting the set once). The benchmark is run once per pass,
+    // the host events are counted in every pass. Results are merged per counter
+    // into the mean over the passes that counted it. With more than one pass the
+    // CSV gets an additional VAR:<counter> column with the variance across passes
+    // for every host event; device events are counted in a single pass and have none.
+    //
+    // Events that are not available on this machine (see PapiSession::HasEvent) or
+    // that cannot be counted at all are skipped with a warning, their CSV columns
+    // stay empty.
+    //
+    // As a CounterSource the host events and the device events of the current
+    // pass are read with PAPI_read on the power sampler thread during a run.
+    //
+    // In per-thread mode every thread of the process gets its own host event set
+    // attached to its tid (PAPI_attach), threads are looked up on every Start().
+    class PapiWrapper : public CounterWrapper{
         public:
             PapiWrapper(Target target, std::list<int> device_ids = {0}, int event_set = 0);
             PapiWrapper();
+            ~PapiWrapper();
+
+            // Event sets belong to exactly one wrapper
+            PapiWrapper(PapiWrapper const&) = delete;
+            PapiWrapper& operator=(PapiWrapper const&) = delete;
+            PapiWrapper(PapiWrapper&& other);
+            PapiWrapper& operator=(PapiWrapper&& other);
 
             void Start();
             void Stop();
@@ -20,27 +79,68 @@ namespace mb{
             std::string GetCsvLine();
 
             void ConfigureDevices(std::list<int> device_ids);
+            void ConfigureDeviceEvents(std::list<std::string> event_bases);
+            void ConfigureThreads(bool per_thread);
+            void WriteThreadCsv(std::string path);
+            void ConfigureEventCache(std::string path);
+
+            // Plans the passes on first use
+            int PassCount();
+            void ConfigurePass(int pass);
+
+            int CounterCount();
+            std::string CounterName(int counter);
+            void Read(uint64_t* values);
 
         private:
             Target target;
+            bool initialized;
             
             int host_eventset;
             std::list<int> host_events;
-            long_long *host_counters;
+            std::vector<long_long> host_counters;
 
-            int device_eventset;
+            // Columns of the host events in the host event set, read into host_values
+            std::vector<int> host_columns;
+            std::vector<long_long> host_values;
+
+            // Per-thread mode: one attached host event set per thread id
+            bool per_thread;
+            std::map<long, int> thread_eventsets;
+            std::vector<long_long> thread_values;
+            ThreadCounters thread_counters;
+
+            // One device event set per pass and the column of each of its events
             std::list<std::string> device_events;
-            long_long *device_counters;
+            std::vector<int> device_eventsets;
+            std::vector<std::vector<int>> pass_columns;
+            std::vector<std::vector<long_long>> pass_counters;
+            int current_pass;
+            std::vector<long_long> read_counters;
+
+            // Host columns followed by device columns, merged over the passes
+            std::vector<double> counter_sum;
+            std::vector<double> counter_sum2;
+            std::vector<int> counter_passes;
 
             std::list<std::list<std::string>> device_event_sets;
             int event_set_selection;
+            std::list<std::string> device_event_bases;
             std::list<int> devices;
 
             void initAmd();
             void initPapi();
+            void releasePapi();
 
             void initHostEventset();
-            void initDeviceEventset();
+            void updateThreadEventsets();
+            void releaseThreadEventset(int& eventset);
+            void initDeviceEventsets();
+            bool tryAddEvent(int eventset, std::string event);
+            void clearCounters();
+            double getMean(int column);
+            std::string getMeanString(int column);
+            double getVariance(int column);
 
             void handleReturn(int retval);            
 
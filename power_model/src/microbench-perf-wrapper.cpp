@@ -0,0 +1,246 @@
+#include "microbench-perf-wrapper.h"
+#include <iostream>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+using namespace mb;
+using namespace std;
+
+static CounterWrapperRegistration registration("perf", [](Target target){
+    return (shared_ptr<CounterWrapper>)make_shared<PerfWrapper>(target);
+});
+
+// PAPI presets of the host event set and their generic perf events, an
+// unsupported config marks presets without a generic equivalent
+static const uint64_t UNSUPPORTED = UINT64_MAX;
+
+mb::PerfWrapper::PerfWrapper(Target){
+    cout << "perf_event Wrapper for host counters!" << endl;
+
+    names = {"PAPI_TOT_INS", "PAPI_FP_INS", "PAPI_BR_INS", "PAPI_VEC_INS", "PAPI_TOT_CYC"};
+    configs = {PERF_COUNT_HW_INSTRUCTIONS, UNSUPPORTED, PERF_COUNT_HW_BRANCH_INSTRUCTIONS, UNSUPPORTED, PERF_COUNT_HW_CPU_CYCLES};
+    types.assign(names.size(), PERF_TYPE_HARDWARE);
+
+    counters.assign(names.size(), 0);
+    read_buffer.assign(3 + names.size(), 0);
+    thread_counters = ThreadCounters(names);
+    per_thread = false;
+    warned = false;
+
+    openEvents();
+}
+
+mb::PerfWrapper::~PerfWrapper(){
+    closeGroup(files);
+    for (auto& [tid, group] : thread_files) closeGroup(group);
+}
+
+void mb::PerfWrapper::Start(){
+    if (per_thread){
+        updateThreads();
+        for (auto& [tid, group] : thread_files){
+            controlGroup(group, PERF_EVENT_IOC_RESET);
+            controlGroup(group, PERF_EVENT_IOC_ENABLE);
+        }
+    }
+
+    controlGroup(files, PERF_EVENT_IOC_RESET);
+    controlGroup(files, PERF_EVENT_IOC_ENABLE);
+}
+
+void mb::PerfWrapper::Stop(){
+    controlGroup(files, PERF_EVENT_IOC_DISABLE);
+    readGroup(files, counters.data());
+    if (!per_thread) return;
+
+    // Host columns are the totals of the threads, as for the papi backend
+    thread_counters.Clear();
+    vector<uint64_t> values(names.size(), 0);
+    for (auto& [tid, group] : thread_files){
+        controlGroup(group, PERF_EVENT_IOC_DISABLE);
+        fill(values.begin(), values.end(), 0);
+        if (readGroup(group, values.data())) thread_counters.Add(tid, values.data());
+    }
+    for (size_t i = 0; i < names.size(); i++) counters[i] = thread_counters.Total(i);
+}
+
+void mb::PerfWrapper::Print(){
+    // Print Host Counter to Console            
+    cout << "HOST COUNTERS:" << endl;
+    for (size_t i = 0; i < names.size(); i++){
+        cout << "\t" << names[i] << ": " << (files[i] >= 0 ? to_string(counters[i]) : "not supported") << endl;
+    }
+    if (per_thread) thread_counters.Print();
+}
+
+string mb::PerfWrapper::GetCsvHeader(){
+    string line_str = "";
+    for (string const& name : names){
+        line_str += name + ",";
+    }
+    if (per_thread) line_str += thread_counters.GetCsvHeader();
+    return line_str;
+}
+
+string mb::PerfWrapper::GetCsvLine(){
+    string line_str = "";
+    for (size_t i = 0; i < names.size(); i++){
+        line_str += (files[i] >= 0 ? to_string(counters[i]) : "") + ",";
+    }
+    if (per_thread) line_str += thread_counters.GetCsvLine();
+    return line_str;
+}
+
+// Host counters only, there are no device events to select
+void mb::PerfWrapper::ConfigureDevices(std::list<int>){}
+
+void mb::PerfWrapper::ConfigureDeviceEvents(std::list<std::string> event_bases){
+    if (event_bases.size() > 0 && !warned){
+        cout << "WARNING: Device events need the papi counter backend, only host counters are collected!" << endl;
+        warned = true;
+    }
+}
+
+void mb::PerfWrapper::ConfigureThreads(bool enabled){
+    per_thread = enabled;
+    if (!per_thread){
+        for (auto& [tid, group] : thread_files) closeGroup(group);
+        thread_files.clear();
+    }
+}
+
+void mb::PerfWrapper::WriteThreadCsv(std::string path){
+    thread_counters.WriteCsv(path);
+}
+
+int mb::PerfWrapper::CounterCount(){
+    return names.size();
+}
+
+string mb::PerfWrapper::CounterName(int counter){
+    return names[counter];
+}
+
+void mb::PerfWrapper::Read(uint64_t* values){
+    readGroup(files, values);
+}
+
+void mb::PerfWrapper::openEvents(){
+    // Only the calling thread as with PAPI, an inherited group would also count the power sampler thread.
+    // Some kernels reject groups (at open or on read), count every event on its own there.
+    grouped = true;
+    if (!openGroup(0, false, files) || read(leader(files), read_buffer.data(), sizeof(uint64_t) * read_buffer.size()) <= 0){
+        closeGroup(files);
+        grouped = false;
+        openGroup(0, false, files);
+    }
+
+    if (leader(files) < 0){
+        cout << "WARNING: No host counters available through perf_event_open (check perf_event_paranoid or the PMU of this machine)!" << endl;
+        return;
+    }
+    for (size_t i = 0; i < names.size(); i++){
+        if (files[i] < 0) cout << "WARNING: " << names[i] << " is not available through perf_event_open, its column stays empty!" << endl;
+    }
+}
+
+bool mb::PerfWrapper::openGroup(long tid, bool inherit, vector<int>& group){
+    group.assign(names.size(), -1);
+    int group_leader = -1;
+
+    for (size_t i = 0; i < names.size(); i++){
+        if (configs[i] == UNSUPPORTED) continue;
+
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = types[i];
+        attr.config = configs[i];
+        attr.inherit = inherit;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING | (grouped ? PERF_FORMAT_GROUP : 0);
+
+        // Members of a group are enabled and disabled through the leader
+        attr.disabled = grouped && group_leader >= 0 ? 0 : 1;
+        group[i] = syscall(SYS_perf_event_open, &attr, tid, -1, grouped ? group_leader : -1, 0);
+        if (group[i] >= 0 && group_leader < 0) group_leader = group[i];
+    }
+    return group_leader >= 0;
+}
+
+void mb::PerfWrapper::closeGroup(vector<int>& group){
+    for (int& file : group){
+        if (file >= 0) close(file);
+        file = -1;
+    }
+}
+
+void mb::PerfWrapper::controlGroup(vector<int>& group, unsigned long request){
+    if (grouped){
+        if (leader(group) >= 0) ioctl(leader(group), request, PERF_IOC_FLAG_GROUP);
+        return;
+    }
+    for (int file : group){
+        if (file >= 0) ioctl(file, request, 0);
+    }
+}
+
+bool mb::PerfWrapper::readGroup(vector<int>& group, uint64_t* values){
+    if (leader(group) < 0) return false;
+
+    if (grouped){
+        // { nr, time_enabled, time_running, value[nr] }
+        uint64_t* buffer = read_buffer.data();
+        if (read(leader(group), buffer, sizeof(uint64_t) * read_buffer.size()) <= 0) return false;
+        double scale = buffer[2] > 0 ? (double)buffer[1] / buffer[2] : 1.0;
+        uint64_t index = 0;
+        for (size_t i = 0; i < names.size(); i++){
+            if (group[i] < 0) continue;
+            values[i] = index < buffer[0] ? (uint64_t)(buffer[3 + index] * scale) : 0;
+            index++;
+        }
+        return true;
+    }
+
+    // { value, time_enabled, time_running } per event
+    for (size_t i = 0; i < names.size(); i++){
+        if (group[i] < 0) continue;
+        uint64_t buffer[3];
+        if (read(group[i], buffer, sizeof(buffer)) <= 0) continue;
+        double scale = buffer[2] > 0 ? (double)buffer[1] / buffer[2] : 1.0;
+        values[i] = (uint64_t)(buffer[0] * scale);
+    }
+    return true;
+}
+
+int mb::PerfWrapper::leader(vector<int>& group){
+    for (int file : group){
+        if (file >= 0) return file;
+    }
+    return -1;
+}
+
+void mb::PerfWrapper::updateThreads(){
+    vector<long> threads = ThreadCounters::ProcessThreads();
+
+    // Groups of finished threads are closed, new threads get a group of their own
+    for (auto it = thread_files.begin(); it != thread_files.end();){
+        if (!binary_search(threads.begin(), threads.end(), it->first)){
+            closeGroup(it->second);
+            it = thread_files.erase(it);
+        } else {
+            it++;
+        }
+    }
+    for (long tid : threads){
+        if (thread_files.count(tid) > 0) continue;
+        vector<int> group;
+        if (openGroup(tid, false, group)) thread_files[tid] = group;
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <iostream>
+#include <list>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+#include "microbench-counter-wrapper.h"
+
+namespace mb{
+    // Host counters through perf_event_open, no PAPI needed. The events are named
+    // like their PAPI presets and opened as one group (PERF_FORMAT_GROUP) of user
+    // space counters of the calling thread, like PAPI counts them. Worker threads
+    // are only counted with ConfigureThreads(true). Events without a generic perf
+    // equivalent (or without a PMU, e.g. in a VM) keep their column and are left
+    // empty. Device events are not supported.
+    class PerfWrapper : public CounterWrapper{
+        public:
+            PerfWrapper(Target target);
+            ~PerfWrapper();
+
+            // The counters belong to exactly one wrapper
+            PerfWrapper(PerfWrapper const&) = delete;
+            PerfWrapper& operator=(PerfWrapper const&) = delete;
+
+            void Start();
+            void Stop();
+            void Print();
+
+            std::string GetCsvHeader();
+            std::string GetCsvLine();
+
+            void ConfigureDevices(std::list<int> device_ids);
+            void ConfigureDeviceEvents(std::list<std::string> event_bases);
+            void ConfigureThreads(bool per_thread);
+            void WriteThreadCsv(std::string path);
+
+            int CounterCount();
+            std::string CounterName(int counter);
+            void Read(uint64_t* values);
+
+        private:
+            std::vector<std::string> names;
+            std::vector<uint32_t> types;
+            std::vector<uint64_t> configs;
+
+            // One descriptor per event (-1 if unsupported), the first open one leads the group
+            std::vector<int> files;
+            bool grouped;
+
+            // Per-thread mode: one group per thread id, kept open while the thread exists
+            bool per_thread;
+            std::map<long, std::vector<int>> thread_files;
+            ThreadCounters thread_counters;
+
+            // Counts of the last run, scaled up if the kernel multiplexed the group
+            std::vector<uint64_t> counters;
+            std::vector<uint64_t> read_buffer;
+            bool warned;
+
+            void openEvents();
+            bool openGroup(long tid, bool inherit, std::vector<int>& group);
+            void closeGroup(std::vector<int>& group);
+            void controlGroup(std::vector<int>& group, unsigned long request);
+            bool readGroup(std::vector<int>& group, uint64_t* values);
+            int leader(std::vector<int>& group);
+            void updateThreads();
+    };
+}
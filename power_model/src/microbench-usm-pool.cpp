@@ -0,0 +1,79 @@
+#include "microbench-usm-pool.h"
+#include <iostream>
+#include <cstdlib>
+
+using namespace mb;
+using namespace std;
+
+mb::UsmPool::UsmPool(sycl::queue q) : queue(q){
+    allocations = 0;
+    reuses = 0;
+}
+
+mb::UsmPool::~UsmPool(){
+    Trim();
+    for (auto const& [pointer, bucket] : used) sycl::free(pointer, queue);
+}
+
+sycl::queue& mb::UsmPool::Queue(){
+    return queue;
+}
+
+void* mb::UsmPool::Allocate(size_t bytes, sycl::usm::alloc kind){
+    Bucket bucket = {kind, bucketSize(bytes)};
+
+    auto it = cached.find(bucket);
+    if (it != cached.end() && it->second.size() > 0){
+        void* pointer = it->second.back();
+        it->second.pop_back();
+        used[pointer] = bucket;
+        reuses++;
+        return pointer;
+    }
+
+    // Blocks of other sizes may be what keeps the device full
+    void* pointer = sycl::malloc(bucket.second, queue, kind);
+    if (pointer == nullptr){
+        Trim();
+        pointer = sycl::malloc(bucket.second, queue, kind);
+    }
+    if (pointer == nullptr){
+        cout << "ERROR: Cannot allocate " << bucket.second << " bytes of USM memory on the device!" << endl;
+        exit(1);
+    }
+    used[pointer] = bucket;
+    allocations++;
+    return pointer;
+}
+
+void mb::UsmPool::Release(void* pointer){
+    auto it = used.find(pointer);
+    if (it == used.end()){
+        sycl::free(pointer, queue);
+        return;
+    }
+    cached[it->second].push_back(pointer);
+    used.erase(it);
+}
+
+void mb::UsmPool::Trim(){
+    for (auto& [bucket, pointers] : cached){
+        for (void* pointer : pointers) sycl::free(pointer, queue);
+    }
+    cached.clear();
+}
+
+size_t mb::UsmPool::Allocations(){
+    return allocations;
+}
+
+size_t mb::UsmPool::Reuses(){
+    return reuses;
+}
+
+size_t mb::UsmPool::bucketSize(size_t bytes){
+    // Powers of two from one page on, sweeps over the array size share buckets
+    size_t bucket = 4096;
+    while (bucket < bytes) bucket *= 2;
+    return bucket;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <sycl/sycl.hpp>
+#include <map>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+namespace mb{
+    // Queue of one device together with its USM allocations. Released
+    // allocations are kept in power-of-two buckets and handed out again, so repeated
+    // runs pay queue creation and page mapping only once. All memory is freed when
+    // the pool is destroyed.
+    class UsmPool{
+        public:
+            UsmPool(sycl::queue queue);
+            ~UsmPool();
+
+            // Allocations belong to exactly one pool
+            UsmPool(UsmPool const&) = delete;
+            UsmPool& operator=(UsmPool const&) = delete;
+
+            sycl::queue& Queue();
+
+            void* Allocate(size_t bytes, sycl::usm::alloc kind = sycl::usm::alloc::shared);
+            void Release(void* pointer);
+
+            template<typename T>
+            T* Allocate(size_t count, sycl::usm::alloc kind = sycl::usm::alloc::shared){
+                return static_cast<T*>(Allocate(count * sizeof(T), kind));
+            }
+
+            // Free all cached (not handed out) allocations
+            void Trim();
+
+            size_t Allocations();
+            size_t Reuses();
+
+        private:
+            sycl::queue queue;
+
+            // Bucket (kind and size) of every handed out allocation, free allocations per bucket
+            typedef std::pair<sycl::usm::alloc, size_t> Bucket;
+            std::map<void*, Bucket> used;
+            std::map<Bucket, std::vector<void*>> cached;
+
+            size_t allocations;
+            size_t reuses;
+
+            static size_t bucketSize(size_t bytes);
+    };
+}
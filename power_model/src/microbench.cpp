@@ -1,5 +1,5 @@
 #include "microbench.h"
-#include "microbench-papi-wrapper.h"
+#include "microbench-counter-wrapper.h"
 #include "power-wrappers/microbench-power-wrapper.h"
 
 #include <iostream>
@@ -9,6 +9,9 @@
 #include <chrono>
 #include <thread>
 #include <fstream>
+#include <climits>
+#include <cmath>
+#include <algorithm>
 
 using namespace mb;
 using namespace std;
@@ -17,15 +20,32 @@ mb::BenchmarkInfo::BenchmarkInfo(string name){
     Name = name;
 }
 
-mb::BenchmarkSuite::BenchmarkSuite(Target target, mb::DataType dataType){
+mb::BenchmarkSuite::BenchmarkSuite(Target t, mb::DataType dataType) : power(10 * 1000){
     cout << "SYCL MicroBenchmark Suite!" << endl;
     
     // Create measurement tools
-    papi = PapiWrapper(target);
-    power = PowerWrapper(10 * 1000);
+    target = t;
+    counters = CounterWrapperRegistry::Create("", target);
 
     // Configure measurement tools
     ConfigureDeviceSelection(0, mb::DeviceType::GPU);
+    kernel_count = 0;
+    kernel_duration = 0.0;
+    run_measured = false;
+    run_launched = false;
+    kernel_energy.assign(power.GetDeviceCount(), NAN);
+    counter_sampling_divisor = 0;
+    setup_duration = 0.0;
+    measured_duration = 0.0;
+    allocation_strategy = AllocationStrategy::SHARED;
+    allocation_advice = 0;
+    vector_width = 1;
+    work_group_size = 0;
+    local_memory_size = 0;
+    run_work_group = 0;
+    run_local_memory = 0;
+    active_units = 0;
+    run_active_units = 0;
 
     // Register all available benchmarks based on the data type
     if (dataType == mb::DataType::INT){
@@ -42,26 +62,31 @@ mb::BenchmarkSuite::BenchmarkSuite(Target target, mb::DataType dataType){
     cout << "Counting a total number of " << benchmarks.size() << " benchmarks." << endl;
 }
 
+// Op mix of the add benchmark, also the load of the sampler perturbation benchmark
+typedef Ops<Add<B, C>, Add<A, B>, Add<A, C>> AddOps;
+
 template<typename T>
 void mb::BenchmarkSuite::registerBenchmarks(){
     registerBenchmark(Benchmark::INFO, &BenchmarkSuite::benchmark_info<T>, "Information");
     registerBenchmark(Benchmark::IDLE, &BenchmarkSuite::benchmark_idle<T>, "Idle");
-    registerBenchmark(Benchmark::ADD, &BenchmarkSuite::benchmark_add<T>, "Add");
+    registerBenchmark(Benchmark::SAMPLER_PERTURBATION, &BenchmarkSuite::benchmark_sampler_perturbation<T>, "Sampler Perturbation");
+    registerBenchmark(Benchmark::ADD, &BenchmarkSuite::benchmark_ops<T, AddOps, 3>, "Add");
     registerBenchmark(Benchmark::ADD_BABEL, &BenchmarkSuite::benchmark_add_babel<T>, "Add Babel");
     registerBenchmark(Benchmark::ADD_LOCAL, &BenchmarkSuite::benchmark_add_local<T>, "Add Local");
+    registerBenchmark(Benchmark::OCCUPANCY, &BenchmarkSuite::benchmark_occupancy<T>, "Occupancy");
 
-    registerBenchmark(Benchmark::TRIAD, &BenchmarkSuite::benchmark_triad<T>, "Triad");
-    registerBenchmark(Benchmark::COPY, &BenchmarkSuite::benchmark_copy<T>, "Copy");
-    registerBenchmark(Benchmark::MULT, &BenchmarkSuite::benchmark_mult<T>, "Multiply");
-    registerBenchmark(Benchmark::SIN, &BenchmarkSuite::benchmark_sin<T>, "Sine");
-    registerBenchmark(Benchmark::SQRT, &BenchmarkSuite::benchmark_sqrt<T>, "Squareroot");
-    registerBenchmark(Benchmark::LOG, &BenchmarkSuite::benchmark_sqrt<T>, "Logarithm");
+    registerBenchmark(Benchmark::TRIAD, &BenchmarkSuite::benchmark_ops<T, Ops<Triad<B, C>, Triad<C, B>>, 5>, "Triad");
+    registerBenchmark(Benchmark::COPY, &BenchmarkSuite::benchmark_ops<T, Ops<B, C>, 5>, "Copy");
+    registerBenchmark(Benchmark::MULT, &BenchmarkSuite::benchmark_ops<T, Ops<Scale<C>, Scale<B>>, 5>, "Multiply");
+    registerBenchmark(Benchmark::SIN, &BenchmarkSuite::benchmark_ops<T, Ops<Sin<B>, Sin<C>>, 5>, "Sine");
+    registerBenchmark(Benchmark::SQRT, &BenchmarkSuite::benchmark_ops<T, Ops<Sqrt<B>, Sqrt<C>>, 5>, "Squareroot");
+    registerBenchmark(Benchmark::LOG, &BenchmarkSuite::benchmark_ops<T, Ops<Log<B>, Log<C>>, 5>, "Logarithm");
 
-    registerBenchmark(Benchmark::TEST_1, &BenchmarkSuite::benchmark_test_1<T>, "TEST 1");
-    registerBenchmark(Benchmark::TEST_2, &BenchmarkSuite::benchmark_test_2<T>, "TEST 2");
-    registerBenchmark(Benchmark::TEST_3, &BenchmarkSuite::benchmark_test_3<T>, "TEST 3");
-    registerBenchmark(Benchmark::TEST_4, &BenchmarkSuite::benchmark_test_4<T>, "TEST 4");
-    registerBenchmark(Benchmark::TEST_5, &BenchmarkSuite::benchmark_test_5<T>, "TEST 5");
+    registerBenchmark(Benchmark::TEST_1, &BenchmarkSuite::benchmark_ops<T, Ops<Add<B, B>, Add<A, B>, Add<A, Sin<B>>>, 1, Inputs<Range<4, 36>>>, "TEST 1");
+    registerBenchmark(Benchmark::TEST_2, &BenchmarkSuite::benchmark_ops<T, Ops<B, Add<A, Sin<B>>, Add<A, Sin<B>>, Add<A, Log<C>>, Add<A, Sqrt<B>>>, 1, Inputs<Range<4, 36>, Range<4, 36>>>, "TEST 2");
+    registerBenchmark(Benchmark::TEST_3, &BenchmarkSuite::benchmark_ops<T, Ops<Triad<C, B>, Triad<A, B>, Scale<Sin<B>>, Scale<Log<B>>>, 1, Inputs<Range<4, 36>, Range<4, 36>>>, "TEST 3");
+    registerBenchmark(Benchmark::TEST_4, &BenchmarkSuite::benchmark_ops<T, Ops<B, Triad<A, B>, C, D, Fma<A, D, B>, Add<A, D>, Add<C, D>, Triad<B, C>, Triad<C, D>, C, D, Scale<D>, Scale<B>>, 1, Inputs<Range<1, 2>, Range<2, 3>, Range<4, 10>>>, "TEST 4");
+    registerBenchmark(Benchmark::TEST_5, &BenchmarkSuite::benchmark_ops<T, Ops<Sin<B>, Sin<C>, Sin<B>, Sqrt<C>, Sqrt<B>, Sqrt<C>, Sqrt<B>, Sqrt<C>, Log<B>, Log<C>, Log<B>, Log<C>, Log<B>, Log<C>, Log<B>>, 1, Inputs<Range<4, 36>, Range<4, 36>>>, "TEST 5");
 }
 
 std::string mb::BenchmarkSuite::GetBenchmarkName(Benchmark benchmark){
@@ -85,9 +110,46 @@ void mb::BenchmarkSuite::Run(Benchmark benchmark, size_t array_size, size_t repe
             BenchmarkInfo info = pair.second.second;
             run_configuration_benchmark_name = info.Name;
 
-            // Run benchmark
+            // Run benchmark, this thread submits all kernels
+            submit_placement.Apply("kernel submission");
             cout << "RUN BENCHMARK: " << info.Name << " (arr: " << run_configuration_array_size << ", n: " << run_configuration_repetition_count << ")" << endl;
-            int ret = (*this.*func)();
+            sweep_lines.clear();
+            run_launched = false;
+
+            if (sweep_work_groups.empty()){
+                string error = checkLaunch(work_group_size, local_memory_size, active_units);
+                if (!error.empty()){
+                    cout << "ERROR: " << error << endl;
+                    exit(1);
+                }
+                runPasses(func);
+                return;
+            }
+
+            // Sweep, the configured launch is restored afterwards
+            size_t configured_size = work_group_size;
+            size_t configured_memory = local_memory_size;
+            size_t configured_units = active_units;
+            for (size_t size : sweep_work_groups){
+                for (size_t memory : sweep_local_memory){
+                    for (size_t units : sweep_active_units){
+                        string error = checkLaunch(size, memory, units);
+                        if (!error.empty()){
+                            cout << "WARNING: " << error << " Skipping it!" << endl;
+                            continue;
+                        }
+                        work_group_size = size;
+                        local_memory_size = memory;
+                        active_units = units;
+                        cout << "SWEEP: work-group " << size << ", local memory " << memory << " B, active units " << units << endl;
+                        runPasses(func);
+                        if (run_measured) sweep_lines.push_back(getCsvLine());
+                    }
+                }
+            }
+            work_group_size = configured_size;
+            local_memory_size = configured_memory;
+            active_units = configured_units;
 
             // Abort further looping
             return;
@@ -97,14 +159,72 @@ void mb::BenchmarkSuite::Run(Benchmark benchmark, size_t array_size, size_t repe
     exit(1);
 }
 
+void mb::BenchmarkSuite::runPasses(int (mb::BenchmarkSuite::*func)()){
+    run_launched = true;
+    run_work_group = work_group_size;
+    run_local_memory = 0;
+    run_active_units = 0;
+
+    // Once per counter pass, benchmarks without measurement run only once
+    auto run_start = chrono::steady_clock::now();
+    measured_duration = 0.0;
+    int passes = counters->PassCount();
+    for (int pass = 0; pass < passes; pass++){
+        if (passes > 1) cout << "COUNTER PASS: " << pass + 1 << " of " << passes << endl;
+        counters->ConfigurePass(pass);
+        run_measured = false;
+        (*this.*func)();
+        if (!run_measured) break;
+    }
+    setup_duration = chrono::duration<double>(chrono::steady_clock::now() - run_start).count() - measured_duration;
+}
+
+std::string mb::BenchmarkSuite::checkLaunch(size_t size, size_t localMemory, size_t units){
+    if (size == 0 && localMemory == 0 && units == 0) return "";
+
+    sycl::device device = getQueue().get_device();
+    size_t max_units = GetComputeUnits();
+    if (units > max_units){
+        return "The " + to_string(units) + " active units exceed the " + to_string(max_units) + " compute units of the device.";
+    }
+    size_t max_size = device.get_info<sycl::info::device::max_work_group_size>();
+    size_t max_memory = device.get_info<sycl::info::device::local_mem_size>();
+    if (size > max_size){
+        return "The work-group size " + to_string(size) + " exceeds the device maximum of " + to_string(max_size) + ".";
+    }
+    if (localMemory > max_memory){
+        return "The local memory of " + to_string(localMemory) + " B exceeds the device maximum of " + to_string(max_memory) + " B.";
+    }
+    return "";
+}
+
 void mb::BenchmarkSuite::Print(){
+    if (!run_launched) return;
     cout << endl;
-    papi.Print();
+    counters->Print();
     power.Print();
+
+    cout << "KERNELS: " << kernel_count << " kernels executed in " << kernel_duration << " s" << endl;
+    cout << "SETUP: " << setup_duration << " s outside of the measurement" << endl;
+    if (run_active_units > 0){
+        // Energy and power attributed to every busy compute unit, the idle ones included in the device total
+        cout << "OCCUPANCY: " << run_active_units << " of " << GetComputeUnits() << " compute units active" << endl;
+        for (int i = 0; i < power.GetDeviceCount(); i++){
+            cout << "\t" << power.GetDeviceName(i) << ": " << kernel_energy[i] / run_active_units << " J, "
+                << kernel_energy[i] / kernel_duration / run_active_units << " W per active unit" << endl;
+        }
+    }
+    if (sweep_lines.size() > 1){
+        cout << "SWEEP: " << sweep_lines.size() << " launch configurations, the values above are from the last one" << endl;
+    }
+    for (int i = 0; i < power.GetDeviceCount(); i++){
+        cout << "\tKERNEL_ENERGY:" << power.GetDeviceName(i) << ": " << kernel_energy[i] << " J => " << kernel_energy[i] / kernel_duration << " J/s" << endl;
+    }
     cout << endl;
 }
 
 void mb::BenchmarkSuite::WriteCsv(std::string path){
+    if (!run_launched) return;
     ifstream f(path.c_str());
     bool exists = f.good();
     
@@ -112,10 +232,15 @@ void mb::BenchmarkSuite::WriteCsv(std::string path){
         ofstream csv_file;
         csv_file.open(path);
         csv_file << getCsvHeader() << endl;
+    }
+
+    // A sweep writes one line per launch configuration
+    ofstream csv_file(path, ios_base::app | ios_base::out);
+    if (sweep_lines.empty()){
         csv_file << getCsvLine() << endl;
-    } else {        
-        ofstream csv_file(path, ios_base::app | ios_base::out);
-        csv_file << getCsvLine() << endl;
+    }
+    for (string const& line : sweep_lines){
+        csv_file << line << endl;
     }
 }
 
@@ -123,10 +248,55 @@ void mb::BenchmarkSuite::WritePowerCsv(std::string path){
     power.WritePowerCsv(path);
 }
 
+void mb::BenchmarkSuite::WritePowerTrace(std::string path){
+    power.WritePowerTrace(path);
+}
+
+void mb::BenchmarkSuite::WriteLatencyCsv(std::string path){
+    power.WriteLatencyCsv(path);
+}
+
 void mb::BenchmarkSuite::ConfigureDeviceSelection(int offset, DeviceType type){
     deviceOffset = offset;
     deviceType = type;
-    papi.ConfigureDevices({deviceOffset});
+    counters->ConfigureDevices({deviceOffset});
+
+    // The work of a CPU device is spread over worker threads, count all of them
+    counters->ConfigureThreads(deviceType == mb::DeviceType::CPU);
+}
+
+void mb::BenchmarkSuite::ConfigureAllocation(AllocationStrategy strategy, int advice){
+    allocation_strategy = strategy;
+    allocation_advice = advice;
+}
+
+void mb::BenchmarkSuite::ConfigureVectorWidth(int width){
+    if (width != 1 && width != 2 && width != 4 && width != 8 && width != 16){
+        cout << "The vector width has to be 1, 2, 4, 8 or 16. Width: " << width << endl;
+        exit(1);
+    }
+    vector_width = width;
+}
+
+void mb::BenchmarkSuite::ConfigureWorkGroup(size_t size, size_t localMemory){
+    work_group_size = size;
+    local_memory_size = localMemory;
+}
+
+void mb::BenchmarkSuite::ConfigureSweep(std::list<size_t> workGroupSizes, std::list<size_t> localMemorySizes, std::list<size_t> activeUnits){
+    sweep_work_groups = workGroupSizes;
+    sweep_local_memory = localMemorySizes;
+    sweep_active_units = activeUnits;
+    if (sweep_local_memory.empty()) sweep_local_memory = {0};
+    if (sweep_active_units.empty()) sweep_active_units = {0};
+}
+
+void mb::BenchmarkSuite::ConfigureActiveUnits(size_t units){
+    active_units = units;
+}
+
+size_t mb::BenchmarkSuite::GetComputeUnits(){
+    return getQueue().get_device().get_info<sycl::info::device::max_compute_units>();
 }
 
 void mb::BenchmarkSuite::ConfigureSleep(int beforeSleep, int afterSleep){
@@ -134,8 +304,80 @@ void mb::BenchmarkSuite::ConfigureSleep(int beforeSleep, int afterSleep){
     after_sleep_duratin = afterSleep;
 }
 
+void mb::BenchmarkSuite::AddPowerSource(std::string name, std::string config, int interval){
+    power.AddSource(name, config, interval);
+    kernel_energy.assign(power.GetDeviceCount(), NAN);
+}
+
+void mb::BenchmarkSuite::ConfigurePowerInterval(int interval){
+    power.ConfigureInterval(interval);
+}
+
+void mb::BenchmarkSuite::ConfigurePowerCapacity(float expectedDuration, OverflowPolicy policy){
+    power.ConfigureCapacity(expectedDuration, policy);
+}
+
+void mb::BenchmarkSuite::ConfigureEnergyMode(EnergyMode mode){
+    power.ConfigureEnergyMode(mode);
+}
+
+void mb::BenchmarkSuite::ConfigurePowerRetention(TraceRetention retention, int decimation){
+    power.ConfigureRetention(retention, decimation);
+}
+
+void mb::BenchmarkSuite::ConfigureSamplerThread(ThreadPlacement placement){
+    power.ConfigureSamplerThread(placement);
+}
+
+void mb::BenchmarkSuite::ConfigurePowerAdaptive(int maxInterval, double threshold){
+    power.ConfigureAdaptive(maxInterval, threshold);
+}
+
+void mb::BenchmarkSuite::ConfigureSubmitThread(ThreadPlacement placement){
+    submit_placement = placement;
+}
+
+void mb::BenchmarkSuite::ConfigureCounters(std::list<std::string> events){
+    counter_events = events;
+    counters->ConfigureDeviceEvents(events);
+}
+
+void mb::BenchmarkSuite::ConfigureCounterBackend(std::string name){
+    // Carry the configuration over to the new backend
+    counters = CounterWrapperRegistry::Create(name, target);
+    counters->ConfigureDevices({deviceOffset});
+    counters->ConfigureThreads(deviceType == mb::DeviceType::CPU);
+    if (counter_events.size() > 0) counters->ConfigureDeviceEvents(counter_events);
+    if (!counter_cache.empty()) counters->ConfigureEventCache(counter_cache);
+    ConfigureCounterSampling(counter_sampling_divisor);
+}
+
+void mb::BenchmarkSuite::ConfigureCounterCache(std::string path){
+    counter_cache = path;
+    counters->ConfigureEventCache(path);
+}
+
+void mb::BenchmarkSuite::ConfigureCounterSampling(int divisor){
+    counter_sampling_divisor = divisor;
+
+    shared_ptr<CounterSource> source;
+    if (divisor > 0) source = counters;
+    power.ConfigureCounters(source, divisor);
+}
+
+void mb::BenchmarkSuite::WriteCounterCsv(std::string path){
+    power.WriteCounterCsv(path);
+}
+
+void mb::BenchmarkSuite::WriteThreadCsv(std::string path){
+    counters->WriteThreadCsv(path);
+}
+
 std::string mb::BenchmarkSuite::getCsvHeader(){
-    string line_str = "benchmark,arr,n,datatype,sleep," + papi.GetCsvHeader() + power.GetCsvHeader();
+    string line_str = "benchmark,arr,n,datatype,vec,work_group,local_memory,active_units,allocation,sleep," + counters->GetCsvHeader() + power.GetCsvHeader() + "kernels,kernel_duration,setup_duration,";
+    for (int i = 0; i < power.GetDeviceCount(); i++){
+        line_str += "KERNEL_ENERGY:" + power.GetDeviceName(i) + "," + "KERNEL_POWER:" + power.GetDeviceName(i) + ",";
+    }
     line_str.pop_back();
     return line_str;
 }
@@ -145,9 +387,18 @@ std::string mb::BenchmarkSuite::getCsvLine(){
     + std::to_string(run_configuration_array_size) + "," 
     + std::to_string(run_configuration_repetition_count) + "," 
     + datatype_name + ","
+    + std::to_string(vector_width) + ","
+    + std::to_string(run_work_group) + ","
+    + std::to_string(run_local_memory) + ","
+    + std::to_string(run_active_units) + ","
+    + getAllocationName() + ","
     + std::to_string(after_sleep_duratin) + ",";
 
-    line_str += papi.GetCsvLine() + power.GetCsvLine();   
+    line_str += counters->GetCsvLine() + power.GetCsvLine();   
+    line_str += to_string(kernel_count) + "," + to_string(kernel_duration) + "," + to_string(setup_duration) + ",";
+    for (int i = 0; i < power.GetDeviceCount(); i++){
+        line_str += to_string(kernel_energy[i]) + "," + to_string(kernel_energy[i] / kernel_duration) + ",";
+    }
     line_str.pop_back();
     return line_str;
 }
@@ -159,17 +410,87 @@ void mb::BenchmarkSuite::registerBenchmark(mb::Benchmark type, int (mb::Benchmar
 }
 
 void mb::BenchmarkSuite::startMeasuring(){
+    run_measured = true;
+    measure_start = chrono::steady_clock::now();
+    kernel_events.clear();
     std::this_thread::sleep_for(std::chrono::milliseconds(before_sleep_duration));
-    papi.Start();
+    counters->Start();
     power.Start();
     std::this_thread::sleep_for(std::chrono::milliseconds(after_sleep_duratin));
 }
 
 void mb::BenchmarkSuite::stopMeasuring(){
     std::this_thread::sleep_for(std::chrono::milliseconds(after_sleep_duratin));
-    papi.Stop();  
-    power.Stop();
+    if (counter_sampling_divisor > 0){
+        // The sampler reads the event sets until it is stopped
+        power.Stop();
+        counters->Stop();
+    } else {
+        counters->Stop();  
+        power.Stop();
+    }
+    recordKernels();
     std::this_thread::sleep_for(std::chrono::milliseconds(before_sleep_duration));
+    measured_duration += chrono::duration<double>(chrono::steady_clock::now() - measure_start).count();
+}
+
+void mb::BenchmarkSuite::recordKernels(){
+    kernel_count = kernel_events.size();
+    kernel_energy.assign(power.GetDeviceCount(), NAN);
+
+    // Without kernels (e.g. idle) the whole measurement is the window
+    if (kernel_count == 0){
+        kernel_duration = power.GetDuration();
+        for (int i = 0; i < power.GetDeviceCount(); i++) kernel_energy[i] = power.GetEnergy(i);
+        return;
+    }
+
+    // Device timestamps are mapped onto the sampler clock, anchored at the host time of each submission
+    long window_start = LONG_MAX;
+    long window_end = LONG_MIN;
+    for (size_t k = 0; k < kernel_events.size(); k++){
+        sycl::event& event = kernel_events[k].first;
+        long host_submit = kernel_events[k].second;
+        long submit = event.get_profiling_info<sycl::info::event_profiling::command_submit>();
+        long start = event.get_profiling_info<sycl::info::event_profiling::command_start>() - submit + host_submit;
+        long end = event.get_profiling_info<sycl::info::event_profiling::command_end>() - submit + host_submit;
+
+        power.AddMarker(host_submit, "kernel_submit:" + to_string(k));
+        power.AddMarker(start, "kernel_start:" + to_string(k));
+        power.AddMarker(end, "kernel_end:" + to_string(k));
+
+        window_start = start < window_start ? start : window_start;
+        window_end = end > window_end ? end : window_end;
+    }
+    kernel_events.clear();
+
+    // Energy from the first kernel start to the last kernel end
+    kernel_duration = (window_end - window_start) / 1000000000.0;
+    bool covered = true;
+    for (int i = 0; i < power.GetDeviceCount(); i++){
+        kernel_energy[i] = power.GetEnergy(i, window_start, window_end);
+        if (isfinite(kernel_energy[i])) continue;
+
+        // The retained trace does not bracket the window (TraceRetention::OFF or a decimated
+        // trace), the mean power of the whole measurement stands for the window instead
+        covered = false;
+        double duration = power.GetDuration();
+        kernel_energy[i] = duration > 0 ? power.GetEnergy(i) * kernel_duration / duration : power.GetEnergy(i);
+    }
+    if (!covered){
+        cout << "WARNING: The power trace does not cover the kernel window, the kernel energy is scaled from the whole measurement!" << endl;
+    }
+}
+
+template<typename F>
+sycl::event mb::BenchmarkSuite::submitKernel(sycl::queue& q, F kernel){
+    // The launch of the first kernel is the transition of the run, back-to-back
+    // repetitions would otherwise keep an adaptive sampler at full rate
+    if (kernel_events.empty()) power.MarkTransition();
+    long host_submit = power.Now();
+    sycl::event event = q.submit(kernel);
+    kernel_events.push_back({event, host_submit});
+    return event;
 }
 
 template<typename T>
@@ -177,7 +498,123 @@ T mb::BenchmarkSuite::getRandom(T min, T max){
     return min + static_cast<T>(rand()) /( static_cast <T> ((T)RAND_MAX/(max - min)));
 }
 
-sycl::queue mb::BenchmarkSuite::getQueue(){
+sycl::queue& mb::BenchmarkSuite::getQueue(){
+    return getPool().Queue();
+}
+
+mb::UsmPool& mb::BenchmarkSuite::getPool(){
+    // The first run on a device creates its queue, all later runs reuse it
+    auto key = make_pair((int)deviceType, deviceOffset);
+    auto it = device_pools.find(key);
+    if (it == device_pools.end()){
+        it = device_pools.insert({key, make_shared<UsmPool>(createQueue())}).first;
+    }
+    return *it->second;
+}
+
+std::string mb::BenchmarkSuite::getAllocationName(){
+    switch (allocation_strategy){
+        case AllocationStrategy::SHARED_PREFETCH: return "shared_prefetch";
+        case AllocationStrategy::DEVICE: return "device";
+        case AllocationStrategy::HOST: return "host";
+        case AllocationStrategy::BUFFER: return "buffer";
+        default: return "shared";
+    }
+}
+
+template<typename T>
+T* mb::BenchmarkSuite::allocate(size_t count){
+    sycl::usm::alloc kind = sycl::usm::alloc::shared;
+    if (allocation_strategy == AllocationStrategy::DEVICE) kind = sycl::usm::alloc::device;
+    if (allocation_strategy == AllocationStrategy::HOST) kind = sycl::usm::alloc::host;
+    return getPool().Allocate<T>(count, kind);
+}
+
+template<typename T>
+void mb::BenchmarkSuite::initialize(sycl::queue& q, T* array, T value){
+    // Every strategy leaves the data where the measured kernels expect it, no migration
+    // or first touch is left for the measurement
+    size_t count = run_configuration_array_size;
+    switch (allocation_strategy){
+        case AllocationStrategy::SHARED:
+            q.fill(array, value, count);
+            break;
+        case AllocationStrategy::SHARED_PREFETCH:
+            std::fill(array, array + count, value);
+            if (allocation_advice != 0) q.mem_advise(array, count * sizeof(T), allocation_advice);
+            q.prefetch(array, count * sizeof(T));
+            break;
+        case AllocationStrategy::DEVICE: {
+            vector<T> staging(count, value);
+            q.memcpy(array, staging.data(), count * sizeof(T)).wait();
+            break;
+        }
+        case AllocationStrategy::HOST:
+        case AllocationStrategy::BUFFER:
+            std::fill(array, array + count, value);
+            break;
+    }
+}
+
+template<typename T, typename In, typename V>
+KernelArrays<T, V> mb::BenchmarkSuite::createArrays(unsigned mask){
+    sycl::queue& q = getQueue();
+    KernelArrays<T, V> arrays;
+    arrays.Count = run_configuration_array_size;
+    arrays.WorkGroup = work_group_size;
+
+    // Drawn in the order of the former hand-written benchmarks: b, c, d, scalar
+    T values[4] = {(T)0.0, (T)0.0, (T)0.0, (T)0.0};
+    if (mask & B::Mask) values[1] = getRandom<T>(In::RangeB::Lower, In::RangeB::Upper);
+    if (mask & C::Mask) values[2] = getRandom<T>(In::RangeC::Lower, In::RangeC::Upper);
+    if (mask & D::Mask) values[3] = getRandom<T>(In::RangeD::Lower, In::RangeD::Upper);
+    if (mask & Scalar::Mask) arrays.Scalar = getRandom<T>(0.0, 1.0);
+
+    for (int j = 0; j < 4; j++){
+        bool used = j == 0 || (mask & (1u << j));
+
+        if (allocation_strategy == AllocationStrategy::BUFFER){
+            // Every view has four accessors, unused arrays get a single element
+            arrays.Buffers.push_back(sycl::buffer<V, 1>(sycl::range<1>(used ? arrays.Count : 1)));
+            V value = V(values[j]);
+            q.submit([&](sycl::handler& h){
+                sycl::accessor<V, 1, sycl::access::mode::write> array(arrays.Buffers.back(), h);
+                h.fill(array, value);
+            });
+        } else if (used){
+            arrays.Pointers[j] = allocate<V>(arrays.Count);
+            initialize(q, arrays.Pointers[j], V(values[j]));
+        }
+    }
+    q.wait();
+    return arrays;
+}
+
+template<typename T, typename V>
+void mb::BenchmarkSuite::releaseArrays(KernelArrays<T, V>& arrays){
+    for (V*& pointer : arrays.Pointers){
+        if (pointer != nullptr) release(pointer);
+        pointer = nullptr;
+    }
+    arrays.Buffers.clear();
+}
+
+template<typename T, typename F>
+int mb::BenchmarkSuite::withVectorWidth(F benchmark){
+    switch (vector_width){
+        case 2: return benchmark(typename Lanes<T, 2>::Type());
+        case 4: return benchmark(typename Lanes<T, 4>::Type());
+        case 8: return benchmark(typename Lanes<T, 8>::Type());
+        case 16: return benchmark(typename Lanes<T, 16>::Type());
+        default: return benchmark(typename Lanes<T, 1>::Type());
+    }
+}
+
+void mb::BenchmarkSuite::release(void* pointer){
+    getPool().Release(pointer);
+}
+
+sycl::queue mb::BenchmarkSuite::createQueue(){
     
     list<sycl::device> devices;
 
@@ -204,18 +641,28 @@ sycl::queue mb::BenchmarkSuite::getQueue(){
 
     // Create queue
     auto d = *next(devices.begin(), deviceOffset);
-    return sycl::queue(d);
+    sycl::queue q(d, sycl::property::queue::enable_profiling());
+
+    // Spawn the worker threads of a CPU device before the counters look for them
+    if (deviceType == mb::DeviceType::CPU){
+        q.single_task([](){}).wait();
+    }
+    return q;
 }
 
 // Benchmarks =================================================================
 
 template<typename T>
 int mb::BenchmarkSuite::benchmark_info(){        
-    sycl::queue q = getQueue();
+    sycl::queue& q = getQueue();
 
     cout << endl << "----=== Information ===----" << endl << endl;
     cout << "Selected device:   " << q.get_device().get_info<sycl::info::device::name>() << endl;
     cout << "Datatype:          " << datatype_name << " (Size: " << sizeof(T) << " bytes)" << endl;
+    cout << "Vector width:      " << vector_width << endl;
+    cout << "Work-group:        " << work_group_size << " (local memory: " << local_memory_size << " B)" << endl;
+    cout << "Compute units:     " << GetComputeUnits() << " (active: " << active_units << ")" << endl;
+    cout << "Allocation:        " << getAllocationName() << endl;
     cout << "Sleep (before):    " << before_sleep_duration << " ms" << endl;
     cout << "Sleep (after):     " << after_sleep_duratin << " ms" << endl;
     cout << endl;
@@ -232,725 +679,228 @@ int mb::BenchmarkSuite::benchmark_idle(){
 }
 
 template<typename T>
-int mb::BenchmarkSuite::benchmark_add_babel(){
-    sycl::queue q = getQueue();
-
-    T* a = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* b = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* c = sycl::malloc_shared<T>(run_configuration_array_size, q);
-
-    T rb = getRandom<T>(1.0, 2.0);
-    T rc = getRandom<T>(2.0, 4.0);
-
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-            a[i] = 0.0;
-            b[i] = rb;
-            c[i] = rc;
-        });
-    });
-    q.wait();
-    
-    startMeasuring();    
-
-    for (size_t rep = 0; rep < run_configuration_repetition_count; rep++)
-    {
-        q.submit([&](sycl::handler& h){
-            h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-                a[i] = b[i] + c[i];
-            });
-        });
-        q.wait();
-    }
-    
-    stopMeasuring();    
-
-    free(a, q);
-    free(b, q);
-    free(c, q);
-
-    return 0;
-}
-
-template<typename T>
-int mb::BenchmarkSuite::benchmark_add(){
-    sycl::queue q = getQueue();
-
-    T* a = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* b = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* c = sycl::malloc_shared<T>(run_configuration_array_size, q);
-
-    T rb = getRandom<T>(1.0, 2.0);
-    T rc = getRandom<T>(2.0, 4.0);
-    T max = (T)run_configuration_repetition_count;
-
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-            a[i] = 0.0;
-            b[i] = rb;
-            c[i] = rc;
-        });
-    });
-    q.wait();
-    
-    startMeasuring();    
-
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {            
-            for (size_t rep = 0; rep < max; rep++){
-                a[i] = b[i] + c[i];
-                a[i] = a[i] + b[i];
-                a[i] = a[i] + c[i];
-
-                a[i] = b[i] + c[i];
-                a[i] = a[i] + b[i];
-                a[i] = a[i] + c[i];
-
-                a[i] = b[i] + c[i];
-                a[i] = a[i] + b[i];
-                a[i] = a[i] + c[i];
-            }
-        });
-    });
-    q.wait();
-    
-    stopMeasuring();    
-
-    free(a, q);
-    free(b, q);
-    free(c, q);
-
-    return 0;
-}
-
-template<typename T>
-int mb::BenchmarkSuite::benchmark_add_local(){
-    sycl::queue q = getQueue();
-
-    T* a = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* b = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* c = sycl::malloc_shared<T>(run_configuration_array_size, q);
-
-    T rb = getRandom<T>(1.0, 2.0);
-    T rc = getRandom<T>(2.0, 4.0);
-    T max = (T)run_configuration_repetition_count;
-
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-            a[i] = 0.0;
-            b[i] = rb;
-            c[i] = rc;
-        });
-    });
-    q.wait();
-    
-    startMeasuring();    
-
-        
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-            T Value1 = 0;
-            T Value2 = 0;
-            T Value3 = 0;
-            T Value = 0; 
-            T I1 = b[i];
-            T I2 = c[i];
-
-            #pragma unroll
-            for (size_t rep = 0; rep < 700000000; rep++){
-                Value1 = I1 + I2;
-    	        Value3 = I1 - I2;
-    	        Value1 += Value2;
-    	        Value1 += Value2;
-    	        Value2 = Value3 - Value1;
-    	        Value1 = Value2 + Value3;
-            }
-            
-            a[i]= Value1 + Value2;
-        });
-    });
-    q.wait();
-    
-    stopMeasuring();    
-
-    free(a, q);
-    free(b, q);
-    free(c, q);
-
-    return 0;
-}
-
-template<typename T>
-int mb::BenchmarkSuite::benchmark_triad(){
-    sycl::queue q = getQueue();
-
-    T* a = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* b = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* c = sycl::malloc_shared<T>(run_configuration_array_size, q);
-
-    T rb = getRandom<T>(1.0, 2.0);
-    T rc = getRandom<T>(2.0, 4.0);
-    T scalar = getRandom<T>(0.0, 1.0);
-    T max = (T)run_configuration_repetition_count;
-
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-            a[i] = 0.0;
-            b[i] = rb;
-            c[i] = rc;
-        });
-    });
-    q.wait();
-
-    startMeasuring();    
-
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {            
-            for (size_t rep = 0; rep < max; rep++){
-                a[i] = b[i] + scalar * c[i];
-                a[i] = c[i] + scalar * b[i];
-
-                a[i] = b[i] + scalar * c[i];
-                a[i] = c[i] + scalar * b[i];
-
-                a[i] = b[i] + scalar * c[i];
-                a[i] = c[i] + scalar * b[i];
-
-                a[i] = b[i] + scalar * c[i];
-                a[i] = c[i] + scalar * b[i];
-
-                a[i] = b[i] + scalar * c[i];
-                a[i] = c[i] + scalar * b[i];
-            }
-        });
-    });
-    q.wait();
-    
-    stopMeasuring();  
-    
-    free(a, q);
-    free(b, q);
-    free(c, q);
-
-    return 0;
-}
-
-template<typename T>
-int mb::BenchmarkSuite::benchmark_copy(){
-    sycl::queue q = getQueue();
+int mb::BenchmarkSuite::benchmark_sampler_perturbation(){
+    sycl::queue& q = getQueue();
 
-    T* a = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* b = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* c = sycl::malloc_shared<T>(run_configuration_array_size, q);
-
-    T rb = getRandom<T>(1.0, 2.0);
-    T rc = getRandom<T>(2.0, 4.0);
     T max = (T)run_configuration_repetition_count;
+    KernelArrays<T> arrays = createArrays<T, Inputs<>>(AddOps::Mask);
 
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-            a[i] = 0.0;
-            b[i] = rb;
-            c[i] = rc;
-        });
-    });
-    q.wait();
-
-    startMeasuring();    
-
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {            
-            for (size_t rep = 0; rep < max; rep++){
-                a[i] = b[i];
-                a[i] = c[i];
-
-                a[i] = b[i];
-                a[i] = c[i];
-
-                a[i] = b[i];
-                a[i] = c[i];
-
-                a[i] = b[i];
-                a[i] = c[i];
-
-                a[i] = b[i];
-                a[i] = c[i];
+    // Same kernel as the add benchmark
+    auto kernel = [&](){
+        q.submit(arrays.Kernel([=](auto const& v, size_t i){
+            for (size_t rep = 0; rep < max; rep++) AddOps::Apply(v, i);
+        }));
+        q.wait();
+    };
+
+    // Alternate between sampling off (only start and stop are read, energy from the
+    // hardware counters) and on, so that drift affects both alike. The last run samples,
+    // its measurement is the one reported by Print and WriteCsv.
+    int interval = power.GetInterval();
+    EnergyMode energy_mode = power.GetEnergyMode();
+    power.ConfigureEnergyMode(EnergyMode::COUNTER);
+
+    const int rounds = 3;
+    int device_count = power.GetDeviceCount();
+    double time_sum[2] = {0.0, 0.0};
+    vector<double> device_energy[2] = {vector<double>(device_count, 0.0), vector<double>(device_count, 0.0)};
+    vector<bool> counted(device_count, true);
+    for (int round = 0; round < rounds; round++){
+        for (int sampling = 0; sampling < 2; sampling++){
+            power.ConfigureInterval(sampling ? interval : 0);
+
+            startMeasuring();
+            auto start = chrono::steady_clock::now();
+            kernel();
+            time_sum[sampling] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            stopMeasuring();
+
+            for (int i = 0; i < device_count; i++){
+                device_energy[sampling][i] += power.GetEnergy(i);
+                counted[i] = counted[i] && power.IsEnergyCounted(i);
             }
-        });
-    });
-    q.wait();
-    
-    stopMeasuring();    
-
-    
-    free(a, q);
-    free(b, q);
-    free(c, q);    
-
-    return 0;
-}
-
-template<typename T>
-int mb::BenchmarkSuite::benchmark_mult(){
-    sycl::queue q = getQueue();
-
-    T* a = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* b = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* c = sycl::malloc_shared<T>(run_configuration_array_size, q);
-
-    T rb = getRandom<T>(1.0, 2.0);
-    T rc = getRandom<T>(2.0, 4.0);
-    T scalar = getRandom<T>(0.0, 1.0);
-    T max = (T)run_configuration_repetition_count;
-
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-            a[i] = 0.0;
-            b[i] = rb;
-            c[i] = rc;
-        });
-    });
-    q.wait();
-
-    startMeasuring();    
+        }
+    }
+    power.ConfigureEnergyMode(energy_mode);
+
+    // Without a counter, the energy of a device is integrated from the start and stop
+    // samples when sampling is off but from the whole trace when it is on. Such devices
+    // are left out, the energy is NaN if no device has a counter.
+    double energy_sum[2] = {0.0, 0.0};
+    int energy_counters = 0;
+    for (int i = 0; i < device_count; i++){
+        if (!counted[i]) continue;
+        energy_sum[0] += device_energy[0][i];
+        energy_sum[1] += device_energy[1][i];
+        energy_counters++;
+    }
+    if (energy_counters == 0){
+        energy_sum[0] = NAN;
+        energy_sum[1] = NAN;
+    }
 
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {            
-            for (size_t rep = 0; rep < max; rep++){
-                a[i] = scalar * c[i];
-                a[i] = scalar * b[i];
+    double iterations = (double)run_configuration_array_size * run_configuration_repetition_count;
+    double throughput[2] = {iterations * rounds / time_sum[0], iterations * rounds / time_sum[1]};
 
-                a[i] = scalar * c[i];
-                a[i] = scalar * b[i];
+    cout << endl << "SAMPLER PERTURBATION: " << rounds << " rounds, sampling interval " << interval << " us" << endl;
+    cout << "\tOFF: " << time_sum[0] / rounds << " s, " << throughput[0] / 1e6 << " M iterations/s, " << energy_sum[0] / rounds << " J" << endl;
+    cout << "\tON:  " << time_sum[1] / rounds << " s, " << throughput[1] / 1e6 << " M iterations/s, " << energy_sum[1] / rounds << " J" << endl;
+    cout << "\tDELTA: throughput " << (throughput[1] / throughput[0] - 1) * 100 << " %, energy " << (energy_sum[1] / energy_sum[0] - 1) * 100 << " %" << endl;
+    if (energy_counters < device_count){
+        cout << "\tWARNING: Only " << energy_counters << " of " << device_count << " devices have energy counters, the others are left out of the energy!" << endl;
+    }
 
-                a[i] = scalar * c[i];
-                a[i] = scalar * b[i];
-                
-                a[i] = scalar * c[i];
-                a[i] = scalar * b[i];
-
-                a[i] = scalar * c[i];
-                a[i] = scalar * b[i];
-            }
-        });
-    });
-    q.wait();
-    
-    stopMeasuring();  
-    
-    free(a, q);
-    free(b, q);
-    free(c, q);
+    releaseArrays(arrays);
 
     return 0;
 }
 
 template<typename T>
-int mb::BenchmarkSuite::benchmark_sin(){
-    sycl::queue q = getQueue();
-
-    T* a = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* b = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* c = sycl::malloc_shared<T>(run_configuration_array_size, q);
+int mb::BenchmarkSuite::benchmark_add_babel(){
+    return withVectorWidth<T>([&](auto lanes){
+        typedef decltype(lanes) V;
+        sycl::queue& q = getQueue();
 
-    T rb = getRandom<T>(1.0, 2.0);
-    T rc = getRandom<T>(2.0, 4.0);
-    T max = (T)run_configuration_repetition_count;
+        // One kernel launch per repetition
+        KernelArrays<T, V> arrays = createArrays<T, Inputs<>, V>(Ops<Add<B, C>>::Mask);
 
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-            a[i] = 0.0;
-            b[i] = rb;
-            c[i] = rc;
-        });
-    });
-    q.wait();
-    
-    startMeasuring();    
+        startMeasuring();
 
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {            
-            for (size_t rep = 0; rep < max; rep++){
-                a[i] = sin(b[i]);
-                a[i] = sin(c[i]);
-
-                a[i] = sin(b[i]);
-                a[i] = sin(c[i]);
+        for (size_t rep = 0; rep < run_configuration_repetition_count; rep++)
+        {
+            submitKernel(q, arrays.Kernel([=](auto const& v, size_t i){
+                Ops<Add<B, C>>::Apply(v, i);
+            }));
+            q.wait();
+        }
 
-                a[i] = sin(b[i]);
-                a[i] = sin(c[i]);
+        stopMeasuring();
 
-                a[i] = sin(b[i]);
-                a[i] = sin(c[i]);
+        releaseArrays(arrays);
 
-                a[i] = sin(b[i]);
-                a[i] = sin(c[i]);
-            }
-        });
+        return 0;
     });
-    q.wait();
-    
-    stopMeasuring();    
-
-    free(a, q);
-    free(b, q);
-    free(c, q);
-
-    return 0;
 }
 
 template<typename T>
-int mb::BenchmarkSuite::benchmark_sqrt(){
-    sycl::queue q = getQueue();
-
-    T* a = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* b = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* c = sycl::malloc_shared<T>(run_configuration_array_size, q);
-
-    T rb = getRandom<T>(1.0, 2.0);
-    T rc = getRandom<T>(2.0, 4.0);
-    T max = (T)run_configuration_repetition_count;
-
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-            a[i] = 0.0;
-            b[i] = rb;
-            c[i] = rc;
-        });
-    });
-    q.wait();
-    
-    startMeasuring();    
-
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {            
-            for (size_t rep = 0; rep < max; rep++){
-                a[i] = sqrt(b[i]);
-                a[i] = sqrt(c[i]);
-
-                a[i] = sqrt(b[i]);
-                a[i] = sqrt(c[i]);
-
-                a[i] = sqrt(b[i]);
-                a[i] = sqrt(c[i]);
-
-                a[i] = sqrt(b[i]);
-                a[i] = sqrt(c[i]);
-
-                a[i] = sqrt(b[i]);
-                a[i] = sqrt(c[i]);
+int mb::BenchmarkSuite::benchmark_add_local(){
+    return withVectorWidth<T>([&](auto lanes){
+        typedef decltype(lanes) V;
+        sycl::queue& q = getQueue();
+
+        KernelArrays<T, V> arrays = createArrays<T, Inputs<>, V>(Ops<Add<B, C>>::Mask);
+
+        // Local memory needs an explicit work-group size, the tile has at least one element per work-item
+        size_t group = work_group_size;
+        if (group == 0) group = min<size_t>(256, q.get_device().get_info<sycl::info::device::max_work_group_size>());
+        size_t tile_count = max(local_memory_size / sizeof(V), group);
+        run_work_group = group;
+        run_local_memory = tile_count * sizeof(V);
+
+        size_t count = arrays.Count;
+        size_t max = run_configuration_repetition_count;
+
+        startMeasuring();
+
+        // The work-group stages b + c into the tile (larger tiles wrap around the arrays), after
+        // the barrier every work-item walks the tile n times in steps of the work-group size
+        submitKernel(q, arrays.GroupKernel(group, tile_count, [=](auto const& v, sycl::nd_item<1> item, auto const& tile){
+            size_t local = item.get_local_id(0);
+            size_t first = item.get_group(0) * group;
+            for (size_t k = local; k < tile_count; k += group){
+                size_t j = (first + k) % count;
+                tile[k] = v.b[j] + v.c[j];
             }
-        });
-    });
-    q.wait();
-    
-    stopMeasuring();    
+            sycl::group_barrier(item.get_group());
 
-    free(a, q);
-    free(b, q);
-    free(c, q);
-
-    return 0;
-}
-
-template<typename T>
-int mb::BenchmarkSuite::benchmark_log(){
-    sycl::queue q = getQueue();
-
-    T* a = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* b = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* c = sycl::malloc_shared<T>(run_configuration_array_size, q);
-
-    T rb = getRandom<T>(1.0, 2.0);
-    T rc = getRandom<T>(2.0, 4.0);
-    T max = (T)run_configuration_repetition_count;
-
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-            a[i] = 0.0;
-            b[i] = rb;
-            c[i] = rc;
-        });
-    });
-    q.wait();
-    
-    startMeasuring();    
-
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {            
+            V value = V((T)0);
+            size_t k = local;
             for (size_t rep = 0; rep < max; rep++){
-                a[i] = log(b[i]);
-                a[i] = log(c[i]);
-
-                a[i] = log(b[i]);
-                a[i] = log(c[i]);
-
-                a[i] = log(b[i]);
-                a[i] = log(c[i]);
-
-                a[i] = log(b[i]);
-                a[i] = log(c[i]);
-
-                a[i] = log(b[i]);
-                a[i] = log(c[i]);
+                value += tile[k];
+                k += group;
+                if (k >= tile_count) k -= tile_count;
             }
-        });
-    });
-    q.wait();
-    
-    stopMeasuring();    
 
-    free(a, q);
-    free(b, q);
-    free(c, q);
-
-    return 0;
-}
-
-// Test Kernels =================================================================
-
-template<typename T>
-int mb::BenchmarkSuite::benchmark_test_1(){
-    sycl::queue q = getQueue();
-
-    T* a = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* b = sycl::malloc_shared<T>(run_configuration_array_size, q);    
-
-    T rb = getRandom<T>(4.0, 36.0);
-    T max = (T)run_configuration_repetition_count;
+            size_t i = item.get_global_id(0);
+            if (i < count) v.a[i] = value;
+        }));
+        q.wait();
 
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-            a[i] = 0.0;
-            b[i] = rb;            
-        });
-    });
-    q.wait();
+        stopMeasuring();
 
-    startMeasuring();    
+        releaseArrays(arrays);
 
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {            
-            for (size_t rep = 0; rep < max; rep++){
-                a[i] = b[i] + b[i];
-                a[i] = a[i] + b[i];
-                a[i] = a[i] + sin(b[i]);
-            }
-        });
+        return 0;
     });
-    q.wait();
-    
-    stopMeasuring(); 
-    
-    free(a, q);
-    free(b, q);    
-
-    return 0;
 }
 
 template<typename T>
-int mb::BenchmarkSuite::benchmark_test_2(){
-    sycl::queue q = getQueue();
-
-    T* a = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* b = sycl::malloc_shared<T>(run_configuration_array_size, q);    
-    T* c = sycl::malloc_shared<T>(run_configuration_array_size, q);    
-
-    T rb = getRandom<T>(4.0, 36.0);
-    T rc = getRandom<T>(4.0, 36.0);
-    T max = (T)run_configuration_repetition_count;
-
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-            a[i] = 0.0;
-            b[i] = rb;
-            c[i] = rc;
-        });
-    });
-    q.wait();
-
-    startMeasuring();
-
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {            
-            for (size_t rep = 0; rep < max; rep++){
-                a[i] = b[i];
-                a[i] = a[i] + sin(b[i]);
-                a[i] = a[i] + sin(b[i]);
-                a[i] = a[i] + log(c[i]);
-                a[i] = a[i] + sqrt(b[i]);
+int mb::BenchmarkSuite::benchmark_occupancy(){
+    return withVectorWidth<T>([&](auto lanes){
+        typedef decltype(lanes) V;
+        sycl::queue& q = getQueue();
+        sycl::device device = q.get_device();
+
+        KernelArrays<T, V> arrays = createArrays<T, Inputs<>, V>(AddOps::Mask);
+
+        // One persistent work-group per active compute unit. Each group claims more than half of the
+        // local memory, so no compute unit can hold two of them (where the local memory of a work-group
+        // is the one of a compute unit, e.g. AMD CDNA). The amount of work does not depend on the units.
+        // A larger configured local memory is kept, the CSV reports the size actually reserved.
+        size_t units = active_units > 0 ? active_units : GetComputeUnits();
+        size_t group = work_group_size;
+        if (group == 0) group = min<size_t>(256, device.get_info<sycl::info::device::max_work_group_size>());
+        size_t tile_count = max(local_memory_size / sizeof(V), device.get_info<sycl::info::device::local_mem_size>() / 2 / sizeof(V) + 1);
+        run_work_group = group;
+        run_local_memory = tile_count * sizeof(V);
+        run_active_units = units;
+
+        size_t count = arrays.Count;
+        size_t max = run_configuration_repetition_count;
+
+        startMeasuring();
+
+        // The work-items stride over all elements, the tile is only reserved
+        submitKernel(q, arrays.GroupKernel(units, group, tile_count, [=](auto const& v, sycl::nd_item<1> item, auto const&){
+            size_t stride = item.get_global_range(0);
+            for (size_t i = item.get_global_id(0); i < count; i += stride){
+                for (size_t rep = 0; rep < max; rep++){
+                    AddOps::Apply(v, i);
+                }
             }
-        });
-    });
-    q.wait();
-
-    stopMeasuring();
-    
-    free(a, q);
-    free(b, q);    
-    free(c, q);    
-
-    return 0;
-}
-
-template<typename T>
-int mb::BenchmarkSuite::benchmark_test_3(){
-    sycl::queue q = getQueue();
+        }));
+        q.wait();
 
-    T* a = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* b = sycl::malloc_shared<T>(run_configuration_array_size, q);    
-    T* c = sycl::malloc_shared<T>(run_configuration_array_size, q);    
+        stopMeasuring();
 
-    T rb = getRandom<T>(4.0, 36.0);
-    T rc = getRandom<T>(4.0, 36.0);
-    T scalar = getRandom<T>(0.0, 1.0);
-    T max = (T)run_configuration_repetition_count;
+        releaseArrays(arrays);
 
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-            a[i] = 0.0;
-            b[i] = rb;
-            c[i] = rc;
-        });
+        return 0;
     });
-    q.wait();
-
-    startMeasuring();
-
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {            
-            for (size_t rep = 0; rep < max; rep++){
-                a[i] = c[i] + scalar * b[i];
-                a[i] = a[i] + scalar * b[i];
-                a[i] = scalar * sin(b[i]);
-                a[i] = scalar * log(b[i]);
-            }
-        });
-    });
-    q.wait();
-
-    stopMeasuring();
-    
-    free(a, q);
-    free(b, q);    
-    free(c, q);    
-
-    return 0;
 }
 
-template<typename T>
-int mb::BenchmarkSuite::benchmark_test_4(){
-    sycl::queue q = getQueue();
-
-    T* a = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* b = sycl::malloc_shared<T>(run_configuration_array_size, q);    
-    T* c = sycl::malloc_shared<T>(run_configuration_array_size, q);   
-    T* d = sycl::malloc_shared<T>(run_configuration_array_size, q);    
-
-    T rb = getRandom<T>(1.0, 2.0);
-    T rc = getRandom<T>(2.0, 3.0);
-    T rd = getRandom<T>(4.0, 10.0);
-    T scalar = getRandom<T>(0.0, 1.0);
-    T max = (T)run_configuration_repetition_count;
+template<typename T, typename O, int Unroll, typename In>
+int mb::BenchmarkSuite::benchmark_ops(){
+    return withVectorWidth<T>([&](auto lanes){
+        typedef decltype(lanes) V;
+        sycl::queue& q = getQueue();
 
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-            a[i] = 0.0;
-            b[i] = rb;
-            c[i] = rc;
-        });
-    });
-    q.wait();
+        T max = (T)run_configuration_repetition_count;
+        KernelArrays<T, V> arrays = createArrays<T, In, V>(O::Mask);
 
-    startMeasuring();
+        startMeasuring();
 
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {            
+        submitKernel(q, arrays.Kernel([=](auto const& v, size_t i){
             for (size_t rep = 0; rep < max; rep++){
-                a[i] = b[i];
-                a[i] = a[i] + scalar * b[i];
-                a[i] = c[i];
-                a[i] = d[i];
-                a[i] = a[i] + d[i] * b[i];
-
-                a[i] = a[i] + d[i];
-                a[i] = c[i] + d[i];
-                a[i] = b[i] + scalar * c[i];
-                a[i] = c[i] + scalar * d[i];
-                a[i] = c[i];
-                a[i] = d[i];
-
-                a[i] = scalar * d[i];
-                a[i] = scalar * b[i];
+                ApplyUnrolled<O, Unroll>(v, i);
             }
-        });
-    });
-    q.wait();
-
-    stopMeasuring();
-    
-    free(a, q);
-    free(b, q);    
-    free(c, q);    
-    free(d, q);    
-
-    return 0;
-}
-
-template<typename T>
-int mb::BenchmarkSuite::benchmark_test_5(){
-    sycl::queue q = getQueue();
-
-    T* a = sycl::malloc_shared<T>(run_configuration_array_size, q);
-    T* b = sycl::malloc_shared<T>(run_configuration_array_size, q);    
-    T* c = sycl::malloc_shared<T>(run_configuration_array_size, q);    
-
-    T rb = getRandom<T>(4.0, 36.0);
-    T rc = getRandom<T>(4.0, 36.0);
-    T scalar = getRandom<T>(0.0, 1.0);
-    T max = (T)run_configuration_repetition_count;
+        }));
+        q.wait();
 
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {
-            a[i] = 0.0;
-            b[i] = rb;
-            c[i] = rc;
-        });
-    });
-    q.wait();
+        stopMeasuring();
 
-    startMeasuring();
+        releaseArrays(arrays);
 
-    q.submit([&](sycl::handler& h){
-        h.parallel_for(run_configuration_array_size, [=](sycl::id<1> i) {            
-            for (size_t rep = 0; rep < max; rep++){
-                a[i] = sin(b[i]);
-                a[i] = sin(c[i]);
-                a[i] = sin(b[i]);
-
-                a[i] = sqrt(c[i]);
-                a[i] = sqrt(b[i]);
-                a[i] = sqrt(c[i]);
-                a[i] = sqrt(b[i]);
-                a[i] = sqrt(c[i]);
-
-                a[i] = log(b[i]);
-                a[i] = log(c[i]);
-                a[i] = log(b[i]);
-                a[i] = log(c[i]);
-                a[i] = log(b[i]);
-                a[i] = log(c[i]);
-                a[i] = log(b[i]);
-            }
-        });
+        return 0;
     });
-    q.wait();
-
-    stopMeasuring();
-    
-    free(a, q);
-    free(b, q);    
-    free(c, q);    
-
-    return 0;
 }
\ No newline at end of file
@@ -1,11 +1,15 @@
 #pragma once
 
-#include "microbench-papi-wrapper.h"
+#include "microbench-counter-wrapper.h"
 #include "power-wrappers/microbench-power-wrapper.h"
+#include "microbench-usm-pool.h"
+#include "microbench-kernels.h"
 #include <iostream>
 #include <sycl/sycl.hpp>
 #include <utility>
 #include <map>
+#include <vector>
+#include <chrono>
 
 namespace mb{
     enum Benchmark {
@@ -24,7 +28,9 @@ namespace mb{
         TEST_2,
         TEST_3,
         TEST_4,
-        TEST_5
+        TEST_5,
+        SAMPLER_PERTURBATION,
+        OCCUPANCY
     };
 
     enum DeviceType {
@@ -33,6 +39,15 @@ namespace mb{
         GPU
     };
 
+    // Memory of the benchmark arrays and how they are initialized before the measurement
+    enum AllocationStrategy {
+        SHARED,             // Shared USM, initialized by a device kernel
+        SHARED_PREFETCH,    // Shared USM, initialized on the host, then advised and prefetched to the device
+        DEVICE,             // Device USM, initialized with a memcpy from the host
+        HOST,               // Pinned host USM, initialized on the host, the kernels access it remotely
+        BUFFER              // SYCL buffers filled on the device, the runtime manages the memory
+    };
+
     enum DataType {
         INT,
         FLOAT,
@@ -53,85 +68,174 @@ namespace mb{
             void Print();
             void WriteCsv(std::string path);
             void WritePowerCsv(std::string path);
+            void WritePowerTrace(std::string path);
+            void WriteLatencyCsv(std::string path);
             std::string GetBenchmarkName(Benchmark benchmark);
             void ConfigureDeviceSelection(int deviceOffset, DeviceType deviceType);            
+
+            // Advice is passed to mem_advise for SHARED_PREFETCH (backend specific, 0 for none)
+            void ConfigureAllocation(AllocationStrategy strategy, int advice = 0);
+
+            // Lanes per work-item of the arithmetic kernels (1, 2, 4, 8, 16), width N runs them on
+            // sycl::vec<T, N> elements, arr stays the number of work-items
+            void ConfigureVectorWidth(int width);
+
+            // Work-group size of the kernels (0: chosen by the runtime) and local memory in bytes per
+            // work-group of the local-memory kernels (0: one element per work-item)
+            void ConfigureWorkGroup(size_t size, size_t localMemory = 0);
+
+            // Run() repeats the benchmark for every combination of work-group size, local memory and
+            // active compute units, WriteCsv writes one row per combination. Combinations the device
+            // cannot launch are skipped, without any left Print and WriteCsv output nothing. An empty
+            // list of sizes ends the sweep.
+            void ConfigureSweep(std::list<size_t> workGroupSizes, std::list<size_t> localMemorySizes = {0}, std::list<size_t> activeUnits = {0});
+
+            // Compute units the occupancy benchmark keeps busy (0: all of the device)
+            void ConfigureActiveUnits(size_t units);
+            size_t GetComputeUnits();
             void ConfigureSleep(int beforeSleep, int afterSleep);
+            void AddPowerSource(std::string name, std::string config = "", int interval = 0);
+            void ConfigurePowerInterval(int interval);
+            void ConfigurePowerCapacity(float expectedDuration, OverflowPolicy policy = OverflowPolicy::DISCARD_NEWEST);
+            void ConfigureEnergyMode(EnergyMode mode);
+            void ConfigurePowerRetention(TraceRetention retention, int decimation = 10);
+            void ConfigureSamplerThread(ThreadPlacement placement);
+            void ConfigurePowerAdaptive(int maxInterval, double threshold = 5.0);
+            void ConfigureSubmitThread(ThreadPlacement placement);
+
+            // Device counters to collect, the benchmark is repeated once per counter
+            // pass and all passes are merged into one CSV row (power from the last pass)
+            void ConfigureCounters(std::list<std::string> events);
+
+            // Counter backend linked into the binary ("papi", "perf"), papi by default
+            void ConfigureCounterBackend(std::string name);
+
+            // File caching the events available on this machine (default papi-events.cache),
+            // delete it to probe again
+            void ConfigureCounterCache(std::string path);
+
+            // Read the counters on every n-th power sampler tick, 0 only reads them at Stop
+            void ConfigureCounterSampling(int divisor);
+            void WriteCounterCsv(std::string path);
+
+            // Host counters per thread of the last run, only written for CPU devices
+            void WriteThreadCsv(std::string path);
 
         private:
             std::map<Benchmark, std::pair<int (mb::BenchmarkSuite::*)(), mb::BenchmarkInfo>> benchmarks;
             size_t run_configuration_array_size;
             size_t run_configuration_repetition_count;
             std::string run_configuration_benchmark_name;
+            bool run_measured;
+            // False if the sweep of the last run skipped every launch configuration
+            bool run_launched;
             std::string datatype_name;
             
-            mb::PapiWrapper papi;
+            Target target;
+            std::shared_ptr<mb::CounterWrapper> counters;
+            std::list<std::string> counter_events;
+            std::string counter_cache;
             mb::PowerWrapper power;
 
             int deviceOffset;
             DeviceType deviceType;
+            AllocationStrategy allocation_strategy;
+            int allocation_advice;
+            int vector_width;
+            size_t work_group_size;
+            size_t local_memory_size;
+            std::list<size_t> sweep_work_groups;
+            std::list<size_t> sweep_local_memory;
+            size_t active_units;
+            std::list<size_t> sweep_active_units;
+
+            // Launch configuration the kernels of the current run used, and the CSV lines of the sweep
+            size_t run_work_group;
+            size_t run_local_memory;
+            size_t run_active_units;
+            std::vector<std::string> sweep_lines;
+            ThreadPlacement submit_placement;
+            int counter_sampling_divisor;
+
+            // Kernels submitted while measuring with the sampler time of their submission,
+            // their profiled execution window is attributed after stopMeasuring
+            std::vector<std::pair<sycl::event, long>> kernel_events;
+            size_t kernel_count;
+            double kernel_duration;
+            std::vector<double> kernel_energy;
+
+            // Queue and allocations per selected device (type, offset), kept across runs
+            std::map<std::pair<int, int>, std::shared_ptr<mb::UsmPool>> device_pools;
+
+            // Time of the last Run() spent outside of the measurement (queue, allocations, initialization)
+            double setup_duration;
+            double measured_duration;
+            std::chrono::steady_clock::time_point measure_start;
 
             int before_sleep_duration = 0;
             int after_sleep_duratin = 0;
 
             void registerBenchmark(mb::Benchmark type, int (mb::BenchmarkSuite::*func)(), std::string name);        
+            void runPasses(int (mb::BenchmarkSuite::*func)());
+            std::string checkLaunch(size_t size, size_t localMemory, size_t units);
             void startMeasuring();
             void stopMeasuring();
+            void recordKernels();
             std::string getCsvHeader();
             std::string getCsvLine();
-            sycl::queue getQueue();
-
-            template<typename T>
-            T getRandom(T min, T max);
+            sycl::queue& getQueue();
+            mb::UsmPool& getPool();
+            sycl::queue createQueue();
+            void release(void* pointer);
 
-            template<typename T>
-            void registerBenchmarks();
+            std::string getAllocationName();
 
             template<typename T>
-            int benchmark_info();
+            T* allocate(size_t count);
 
             template<typename T>
-            int benchmark_idle();            
+            void initialize(sycl::queue& q, T* array, T value);
 
-            template<typename T>
-            int benchmark_add();
+            // Arrays a-d of an op mix (mask of the arrays read) with their initial values
+            template<typename T, typename In, typename V = T>
+            KernelArrays<T, V> createArrays(unsigned mask);
 
-            template<typename T>
-            int benchmark_add_babel();
+            template<typename T, typename V>
+            void releaseArrays(KernelArrays<T, V>& arrays);
 
-            template<typename T>
-            int benchmark_add_local();
+            // Calls benchmark(V()) with V the lane type of the configured vector width
+            template<typename T, typename F>
+            int withVectorWidth(F benchmark);
 
-            template<typename T>
-            int benchmark_triad();
+            template<typename F>
+            sycl::event submitKernel(sycl::queue& q, F kernel);
 
             template<typename T>
-            int benchmark_copy();
+            T getRandom(T min, T max);
 
             template<typename T>
-            int benchmark_mult();
-            
-            template<typename T>
-            int benchmark_sin();
+            void registerBenchmarks();
 
             template<typename T>
-            int benchmark_log();
+            int benchmark_info();
 
             template<typename T>
-            int benchmark_sqrt();
+            int benchmark_idle();            
 
             template<typename T>
-            int benchmark_test_1();
+            int benchmark_sampler_perturbation();
 
             template<typename T>
-            int benchmark_test_2();
+            int benchmark_add_babel();
 
             template<typename T>
-            int benchmark_test_3();
+            int benchmark_add_local();
 
             template<typename T>
-            int benchmark_test_4();
+            int benchmark_occupancy();
 
-            template<typename T>
-            int benchmark_test_5();
+            // Arithmetic benchmark generated from an op mix, see microbench-kernels.h
+            template<typename T, typename O, int Unroll = 1, typename In = Inputs<>>
+            int benchmark_ops();
     };
 }
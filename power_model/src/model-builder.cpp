@@ -6,12 +6,19 @@
 using namespace mb;
 using namespace std;
 
-mb::RunInfo::RunInfo(size_t repetitions, size_t start, size_t step, size_t step_count, size_t kernel_repetitions){
+mb::RunInfo::RunInfo(size_t repetitions, size_t start, size_t step, size_t step_count, size_t kernel_repetitions, size_t active_unit_step){
     Repetitions = repetitions;
     Start = start;
     Step = step;
     StepCount = step_count;
     KernelRepetitions = kernel_repetitions;
+    ActiveUnitStep = active_unit_step;
+}
+
+mb::PowerSourceInfo::PowerSourceInfo(string name, string config, int interval){
+    Name = name;
+    Config = config;
+    Interval = interval;
 }
 
 string mb::ModelBuilder::createPath(string base, string name){
@@ -20,8 +27,8 @@ string mb::ModelBuilder::createPath(string base, string name){
     return path;
 }
 
-void mb::ModelBuilder::registerRun(mb::Benchmark benchmark, size_t repetitions, size_t start, size_t step, size_t step_count, size_t kernel_repetitions){
-    RunInfo info(repetitions, start, step, step_count, kernel_repetitions);
+void mb::ModelBuilder::registerRun(mb::Benchmark benchmark, size_t repetitions, size_t start, size_t step, size_t step_count, size_t kernel_repetitions, size_t active_unit_step){
+    RunInfo info(repetitions, start, step, step_count, kernel_repetitions, active_unit_step);
     runs.insert({benchmark, info});
 }
 
@@ -34,6 +41,10 @@ void  mb::ModelBuilder::registerRuns(){
     registerRun(mb::Benchmark::MULT, 10, 100000, 50000, 8, 7000000);    
     registerRun(mb::Benchmark::COPY, 10, 100000, 50000, 8, 10000000);
     registerRun(mb::Benchmark::TRIAD, 10, 100000, 50000, 8, 10000000);
+    registerRun(mb::Benchmark::ADD_LOCAL, 10, 100000, 50000, 8, 10000000);
+
+    // Fixed work on 1, 8, 16, ... compute units up to the whole device
+    registerRun(mb::Benchmark::OCCUPANCY, 5, 100000, 0, 1, 100000, 8);
 
     registerRun(mb::Benchmark::LOG, 10, 100000, 50000, 8, 5000000);
     registerRun(mb::Benchmark::SQRT, 10, 100000, 50000, 8, 5000000);
@@ -56,6 +67,17 @@ mb::ModelBuilder::ModelBuilder(string p_model_path, mb::Target p_target, mb::Dat
     data_type = p_data_type;
     device_type = p_device_type;
     device_offset = p_device_offset;
+    energy_mode = mb::EnergyMode::SAMPLES;
+    trace_format = mb::TraceFormat::CSV;
+    latency_csv = false;
+    adaptive_max_interval = 0;
+    adaptive_threshold = 5.0;
+    counter_sampling_divisor = 0;
+    allocation_strategy = mb::AllocationStrategy::SHARED;
+    allocation_advice = 0;
+    vector_widths = {1};
+    work_group_size = 0;
+    local_memory_size = 0;
 
     registerRuns();
     cout << "Counting a total number of " << runs.size() << " run configurations." << endl;
@@ -65,26 +87,141 @@ mb::ModelBuilder::ModelBuilder(string p_model_path, mb::Target p_target, mb::Dat
     filesystem::create_directories(model_path);
 }
 
+void mb::ModelBuilder::AddPowerSource(string name, string config, int interval){
+    power_sources.push_back(PowerSourceInfo(name, config, interval));
+}
+
+void mb::ModelBuilder::ConfigureEnergyMode(mb::EnergyMode mode){
+    energy_mode = mode;
+}
+
+void mb::ModelBuilder::ConfigureTraceFormat(mb::TraceFormat format){
+    trace_format = format;
+}
+
+void mb::ModelBuilder::ConfigureSamplerThread(mb::ThreadPlacement placement){
+    sampler_placement = placement;
+}
+
+void mb::ModelBuilder::ConfigurePowerAdaptive(int max_interval, double threshold){
+    adaptive_max_interval = max_interval;
+    adaptive_threshold = threshold;
+}
+
+void mb::ModelBuilder::ConfigureSubmitThread(mb::ThreadPlacement placement){
+    submit_placement = placement;
+}
+
+void mb::ModelBuilder::ConfigureLatencyCsv(bool enabled){
+    latency_csv = enabled;
+}
+
+void mb::ModelBuilder::ConfigureCounters(std::list<std::string> events){
+    counters = events;
+}
+
+void mb::ModelBuilder::ConfigureCounterSampling(int divisor){
+    counter_sampling_divisor = divisor;
+}
+
+void mb::ModelBuilder::ConfigureCounterBackend(std::string name){
+    counter_backend = name;
+}
+
+void mb::ModelBuilder::ConfigureCounterCache(std::string path){
+    counter_cache = path;
+}
+
+void mb::ModelBuilder::ConfigureAllocation(mb::AllocationStrategy strategy, int advice){
+    allocation_strategy = strategy;
+    allocation_advice = advice;
+}
+
+void mb::ModelBuilder::ConfigureVectorWidths(std::list<int> widths){
+    vector_widths = widths;
+}
+
+void mb::ModelBuilder::ConfigureWorkGroup(size_t size, size_t local_memory){
+    work_group_size = size;
+    local_memory_size = local_memory;
+}
+
 void mb::ModelBuilder::Run(mb::Benchmark benchmark){
     // Configure benchmark suite
     BenchmarkSuite suite(target, data_type);
     suite.ConfigureDeviceSelection(device_offset, device_type);
-    suite.ConfigureSleep(500, 0);
+    suite.ConfigureAllocation(allocation_strategy, allocation_advice);
+    suite.ConfigureWorkGroup(work_group_size, local_memory_size);
+    // The kernel window is taken from the profiling events, no padding around the kernels needed
+    suite.ConfigureSleep(0, 0);
+    for (PowerSourceInfo const& source : power_sources){
+        suite.AddPowerSource(source.Name, source.Config, source.Interval);
+    }
+    suite.ConfigureEnergyMode(energy_mode);
+    suite.ConfigureSamplerThread(sampler_placement);
+    suite.ConfigurePowerAdaptive(adaptive_max_interval, adaptive_threshold);
+    suite.ConfigureSubmitThread(submit_placement);
+    if (!counter_backend.empty()) suite.ConfigureCounterBackend(counter_backend);
+    if (!counter_cache.empty()) suite.ConfigureCounterCache(counter_cache);
+    if (counters.size() > 0) suite.ConfigureCounters(counters);
+    suite.ConfigureCounterSampling(counter_sampling_divisor);
     
     // Find requested benchmark
     RunInfo info = runs.find(benchmark)->second;
     string name = suite.GetBenchmarkName(benchmark);
 
-    // Execute with requested repetitions
-    string benchmark_path = createPath(model_path, name);
+    // Only the arithmetic benchmarks have vector variants
+    list<int> widths = vector_widths;
+    if (benchmark == mb::Benchmark::IDLE || benchmark == mb::Benchmark::INFO || benchmark == mb::Benchmark::SAMPLER_PERTURBATION){
+        widths = {1};
+    }
+
+    // Array size and active compute units (0: all) of every step
+    vector<pair<size_t, size_t>> steps;
+    size_t units = info.ActiveUnitStep > 0 ? suite.GetComputeUnits() : 0;
     for (size_t i = 0; i < info.StepCount; i++){
         size_t arr = info.Start + info.Step * i;
-        string run_path = createPath(benchmark_path, "run_" + to_string(i));
+        if (info.ActiveUnitStep == 0){
+            steps.push_back({arr, 0});
+            continue;
+        }
 
-        for (size_t i = 0; i < info.Repetitions; i++){
-            suite.Run(benchmark, arr, info.KernelRepetitions);
-            suite.WritePowerCsv(run_path + "/power_" + to_string(i) + ".csv");
-            suite.WriteCsv(run_path + "/counter.csv");
+        steps.push_back({arr, 1});
+        for (size_t u = info.ActiveUnitStep; u < units; u += info.ActiveUnitStep){
+            if (u > 1) steps.push_back({arr, u});
+        }
+        if (units > 1) steps.push_back({arr, units});
+    }
+
+    // Execute with requested repetitions
+    string benchmark_path = createPath(model_path, name);
+    for (int width : widths){
+        suite.ConfigureVectorWidth(width);
+        string suffix = width > 1 ? "_vec" + to_string(width) : "";
+
+        for (size_t i = 0; i < steps.size(); i++){
+            size_t arr = steps[i].first;
+            suite.ConfigureActiveUnits(steps[i].second);
+            string run_path = createPath(benchmark_path, "run_" + to_string(i) + suffix);
+
+            for (size_t i = 0; i < info.Repetitions; i++){
+                suite.Run(benchmark, arr, info.KernelRepetitions);
+                if (trace_format == mb::TraceFormat::BINARY){
+                    suite.WritePowerTrace(run_path + "/power_" + to_string(i) + ".mbt");
+                } else {
+                    suite.WritePowerCsv(run_path + "/power_" + to_string(i) + ".csv");
+                }
+                if (latency_csv){
+                    suite.WriteLatencyCsv(run_path + "/latency_" + to_string(i) + ".csv");
+                }
+                if (counter_sampling_divisor > 0){
+                    suite.WriteCounterCsv(run_path + "/counters_" + to_string(i) + ".csv");
+                }
+                if (device_type == mb::DeviceType::CPU){
+                    suite.WriteThreadCsv(run_path + "/threads_" + to_string(i) + ".csv");
+                }
+                suite.WriteCsv(run_path + "/counter.csv");
+            }
         }
     }
 }
\ No newline at end of file
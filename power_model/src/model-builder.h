@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <map>
+#include <list>
 
 #include "microbench.h"
 
@@ -14,13 +15,42 @@ namespace mb{
             size_t StepCount;
             size_t KernelRepetitions;
 
-            RunInfo(size_t repetitions, size_t start, size_t step, size_t step_count, size_t kernel_repetitions);
+            // Every array size runs on 1, step, 2 * step, ... compute units up to the
+            // whole device, 0 runs it once on the whole device
+            size_t ActiveUnitStep;
+
+            RunInfo(size_t repetitions, size_t start, size_t step, size_t step_count, size_t kernel_repetitions, size_t active_unit_step = 0);
+    };
+
+    class PowerSourceInfo{
+        public:
+            std::string Name;
+            std::string Config;
+            int Interval;
+
+            PowerSourceInfo(std::string name, std::string config, int interval);
     };
 
     class ModelBuilder{
         public:
             ModelBuilder(std::string p_model_path, mb::Target p_target, mb::DataType p_data_type = mb::DataType::DOUBLE, mb::DeviceType p_device_type = mb::DeviceType::GPU, int p_device_offset = 0);
             void Run(mb::Benchmark benchmark);
+            void AddPowerSource(std::string name, std::string config = "", int interval = 0);
+            void ConfigureEnergyMode(mb::EnergyMode mode);
+            void ConfigureTraceFormat(mb::TraceFormat format);
+            void ConfigureSamplerThread(mb::ThreadPlacement placement);
+            void ConfigurePowerAdaptive(int max_interval, double threshold = 5.0);
+            void ConfigureSubmitThread(mb::ThreadPlacement placement);
+            void ConfigureLatencyCsv(bool enabled);
+            void ConfigureCounters(std::list<std::string> events);
+            void ConfigureCounterSampling(int divisor);
+            void ConfigureCounterBackend(std::string name);
+            void ConfigureCounterCache(std::string path);
+            void ConfigureAllocation(mb::AllocationStrategy strategy, int advice = 0);
+
+            // Vector widths swept by the arithmetic benchmarks, width N > 1 writes run_<i>_vec<N>
+            void ConfigureVectorWidths(std::list<int> widths);
+            void ConfigureWorkGroup(size_t size, size_t local_memory = 0);
         
         private:
             std::string model_path;
@@ -29,9 +59,26 @@ namespace mb{
             mb::DeviceType device_type; 
             int device_offset;
             std::map<mb::Benchmark, RunInfo> runs;
+            std::list<PowerSourceInfo> power_sources;
+            mb::EnergyMode energy_mode;
+            mb::TraceFormat trace_format;
+            mb::ThreadPlacement sampler_placement;
+            int adaptive_max_interval;
+            double adaptive_threshold;
+            mb::ThreadPlacement submit_placement;
+            bool latency_csv;
+            std::list<std::string> counters;
+            int counter_sampling_divisor;
+            std::string counter_backend;
+            std::string counter_cache;
+            mb::AllocationStrategy allocation_strategy;
+            int allocation_advice;
+            std::list<int> vector_widths;
+            size_t work_group_size;
+            size_t local_memory_size;
 
             std::string createPath(std::string base, std::string name);
-            void registerRun(mb::Benchmark benchmark, size_t repetitions, size_t start, size_t step, size_t step_count, size_t kernel_repetitions);
+            void registerRun(mb::Benchmark benchmark, size_t repetitions, size_t start, size_t step, size_t step_count, size_t kernel_repetitions, size_t active_unit_step = 0);
             void registerRuns();
 
     };
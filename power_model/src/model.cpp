@@ -8,6 +8,7 @@ using namespace std;
 int main(int, char**) {
     string path = (string)filesystem::current_path() + "/measurements/model";    
     mb::ModelBuilder modelBuilder(path, mb::Target::AMD);
+    //modelBuilder.ConfigureVectorWidths({1, 2, 4, 8, 16});
 
     modelBuilder.Run(mb::Benchmark::IDLE);
 
@@ -22,6 +23,9 @@ int main(int, char**) {
     modelBuilder.Run(mb::Benchmark::LOG);
     modelBuilder.Run(mb::Benchmark::SQRT);
 
+    // Power over the number of busy compute units
+    modelBuilder.Run(mb::Benchmark::OCCUPANCY);
+
     // Tests --------------------------
 
     modelBuilder.Run(mb::Benchmark::TEST_1);
@@ -0,0 +1,98 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <list>
+#include <vector>
+#include <papi.h>
+
+#include "microbench-papi-wrapper.h"
+
+using namespace std;
+
+const int RUNS = 200;
+
+double elapsedUs(chrono::steady_clock::time_point start){
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+}
+
+void check(int retval){
+    if (retval != PAPI_OK && retval != PAPI_VER_CURRENT){
+        cout << "PAPI Error: " << retval << endl;
+        exit(1);
+    }
+}
+
+void printResult(string name, double start_us, double stop_us, int runs){
+    cout << name << ": start " << start_us / runs << " us, stop " << stop_us / runs << " us per run (" << runs << " runs)" << endl;
+}
+
+// Previous implementation: library init, new event sets and new counter storage on every run
+void benchmarkReinit(int device){
+    list<int> host_events = {PAPI_TOT_INS, PAPI_FP_INS, PAPI_BR_INS, PAPI_VEC_INS, PAPI_TOT_CYC};
+    list<string> device_events = {
+        "rocm:::SQC_DCACHE_HITS", "rocm:::SQC_DCACHE_MISSES", "rocm:::TCC_HIT_sum", "rocm:::TCC_MISS_sum",
+        "rocm:::SQ_INSTS", "rocm:::SQ_INSTS_VALU", "rocm:::SQ_INSTS_MFMA", "rocm:::SQ_INSTS_SALU"
+    };
+
+    double start_us = 0.0;
+    double stop_us = 0.0;
+    for (int run = 0; run < RUNS; run++){
+        auto start = chrono::steady_clock::now();
+        check(PAPI_library_init(PAPI_VER_CURRENT));
+        int host_eventset = PAPI_NULL;
+        check(PAPI_create_eventset(&host_eventset));
+        for (int event : host_events) check(PAPI_add_event(host_eventset, event));
+        long_long* host_counters = new long_long[host_events.size()]();
+
+        int device_eventset = PAPI_NULL;
+        check(PAPI_create_eventset(&device_eventset));
+        for (string const& event : device_events) check(PAPI_add_named_event(device_eventset, (event + ":device=" + to_string(device)).c_str()));
+        long_long* device_counters = new long_long[device_events.size()]();
+
+        check(PAPI_start(host_eventset));
+        check(PAPI_start(device_eventset));
+        start_us += elapsedUs(start);
+
+        start = chrono::steady_clock::now();
+        check(PAPI_stop(host_eventset, host_counters));
+        check(PAPI_stop(device_eventset, device_counters));
+        check(PAPI_cleanup_eventset(host_eventset));
+        check(PAPI_cleanup_eventset(device_eventset));
+        stop_us += elapsedUs(start);
+    }
+    printResult("REINIT", start_us, stop_us, RUNS);
+}
+
+// Persistent session: the first run creates the event sets, all later runs reset and reuse them
+void benchmarkSession(int device){
+    mb::PapiWrapper papi(mb::Target::AMD, {device});
+
+    auto start = chrono::steady_clock::now();
+    papi.Start();
+    double start_us = elapsedUs(start);
+    start = chrono::steady_clock::now();
+    papi.Stop();
+    printResult("SESSION (first run)", start_us, elapsedUs(start), 1);
+
+    start_us = 0.0;
+    double stop_us = 0.0;
+    for (int run = 0; run < RUNS; run++){
+        start = chrono::steady_clock::now();
+        papi.Start();
+        start_us += elapsedUs(start);
+
+        start = chrono::steady_clock::now();
+        papi.Stop();
+        stop_us += elapsedUs(start);
+    }
+    printResult("SESSION", start_us, stop_us, RUNS);
+}
+
+int main(int argc, char** argv){
+    int device = argc > 1 ? stoi(argv[1]) : 0;
+
+    // The session runs first, so it pays for the component initialization
+    benchmarkSession(device);
+    benchmarkReinit(device);
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include <iostream>
+#include <filesystem>
+#include <chrono>
+#include <list>
+#include <fstream>
+
+#include "power-wrappers/microbench-power-store.h"
+#include "power-wrappers/microbench-power-wrapper.h"
+#include "power-wrappers/microbench-power-source-replay.h"
+#include "power-wrappers/microbench-power-trace.h"
+
+using namespace std;
+
+const int DEVICE_COUNT = 4;
+const long SAMPLE_INTERVAL = 10 * 1000 * 1000;
+
+double elapsedMs(chrono::steady_clock::time_point start){
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+uint64_t syntheticPower(size_t sample, int device){
+    return (uint64_t)(100 + device * 10 + sample % 50) * 1000000;
+}
+
+// Previous implementation: one list node per sample and positional access with std::next
+void benchmarkLists(size_t samples, string path){
+    list<uint64_t> power_values[DEVICE_COUNT];
+    list<long> timestamp_values;
+
+    auto start = chrono::steady_clock::now();
+    for (size_t j = 0; j < samples; j++){
+        for (int i = 0; i < DEVICE_COUNT; i++) power_values[i].push_back(syntheticPower(j, i));
+        timestamp_values.push_back(j * SAMPLE_INTERVAL);
+    }
+    double append_ms = elapsedMs(start);
+
+    start = chrono::steady_clock::now();
+    float energy = 0.0;
+    for (int i = 0; i < DEVICE_COUNT; i++){
+        for (size_t j = 0; j + 1 < samples; j++){
+            int p1 = *next(power_values[i].begin(), j) / 1000000;
+            int p2 = *next(power_values[i].begin(), j + 1) / 1000000;
+            int t1 = *next(timestamp_values.begin(), j) / 1000000;
+            int t2 = *next(timestamp_values.begin(), j + 1) / 1000000;
+            float time_dif = (float)(t2 - t1) / 1000;
+            energy += time_dif * min(p1, p2) + (time_dif * abs(p2 - p1)) / 2;
+        }
+    }
+    double stop_ms = elapsedMs(start);
+
+    start = chrono::steady_clock::now();
+    ofstream csv_file(path);
+    for (size_t j = 0; j < samples; j++){
+        string line = to_string(j) + "," + to_string(*next(timestamp_values.begin(), j)) + ",";
+        for (int i = 0; i < DEVICE_COUNT; i++) line += to_string(*next(power_values[i].begin(), j)) + ",";
+        line.pop_back();
+        csv_file << line << endl;
+    }
+    csv_file.close();
+    double export_ms = elapsedMs(start);
+
+    cout << "list,\t" << samples << ",\t" << append_ms << ",\t" << stop_ms << ",\t" << export_ms << "\t(energy " << energy << " J)" << endl;
+}
+
+void benchmarkStore(size_t samples, string path){
+    mb::PowerStore store(DEVICE_COUNT, samples);
+    uint64_t power[DEVICE_COUNT];
+
+    auto start = chrono::steady_clock::now();
+    for (size_t j = 0; j < samples; j++){
+        for (int i = 0; i < DEVICE_COUNT; i++) power[i] = syntheticPower(j, i);
+        store.Append(j * SAMPLE_INTERVAL, power);
+    }
+    double append_ms = elapsedMs(start);
+
+    start = chrono::steady_clock::now();
+    float duration = store.Duration();
+    float energy = 0.0;
+    for (int i = 0; i < DEVICE_COUNT; i++) energy += store.Energy(i);
+    double stop_ms = elapsedMs(start);
+
+    start = chrono::steady_clock::now();
+    store.WriteCsv(path);
+    double export_ms = elapsedMs(start);
+
+    cout << "store,\t" << samples << ",\t" << append_ms << ",\t" << stop_ms << ",\t" << export_ms << "\t(energy " << energy << " J in " << duration << " s)" << endl;
+}
+
+// Full sampler path (loop, source, statistics, store) on a virtual clock at 100 us intervals
+void benchmarkSampler(size_t samples, mb::TraceRetention retention, string name, string path){
+    double duration = samples * 0.0001;
+    mb::SyntheticProfile profile(DEVICE_COUNT, 5.0);
+    profile.Step(0.0, 100.0);
+    profile.Ramp(duration, 300.0);
+
+    mb::PowerWrapper power(100, make_shared<mb::SyntheticPowerSource>(profile));
+    power.ConfigureCapacity(duration);
+    power.ConfigureRetention(retention);
+
+    auto start = chrono::steady_clock::now();
+    power.Start();
+    power.Stop();
+    double sampler_ms = elapsedMs(start);
+
+    start = chrono::steady_clock::now();
+    string line = power.GetCsvLine();
+    double line_ms = elapsedMs(start);
+
+    start = chrono::steady_clock::now();
+    power.WritePowerCsv(path);
+    double export_ms = elapsedMs(start);
+
+    cout << name << ",\t" << samples << ",\t" << sampler_ms << ",\t" << line_ms << ",\t" << export_ms << "\t(" << samples / sampler_ms / 1000 << " M samples/s)" << endl;
+}
+
+// Trace export and reload: CSV (format + parse) against binary (gathered write + mmap)
+void benchmarkFormats(size_t samples, string csv_path, string trace_path){
+    mb::PowerStore store(DEVICE_COUNT, samples);
+    uint64_t power[DEVICE_COUNT];
+    for (size_t j = 0; j < samples; j++){
+        for (int i = 0; i < DEVICE_COUNT; i++) power[i] = syntheticPower(j, i);
+        store.Append(j * SAMPLE_INTERVAL, power);
+    }
+
+    auto start = chrono::steady_clock::now();
+    store.WriteCsv(csv_path);
+    double csv_write_ms = elapsedMs(start);
+
+    start = chrono::steady_clock::now();
+    vector<string> names;
+    mb::PowerStore csv_store = mb::ReadPowerCsv(csv_path, names);
+    uint64_t csv_sum = 0;
+    for (int i = 0; i < DEVICE_COUNT; i++){
+        for (size_t j = 0; j < csv_store.Size(); j++) csv_sum += csv_store.Power(i, j);
+    }
+    double csv_read_ms = elapsedMs(start);
+
+    start = chrono::steady_clock::now();
+    mb::PowerTrace::Write(trace_path, store, {}, "CLOCK_MONOTONIC");
+    double trace_write_ms = elapsedMs(start);
+
+    start = chrono::steady_clock::now();
+    uint64_t trace_sum = 0;
+    {
+        mb::PowerTrace trace(trace_path);
+        for (int i = 0; i < trace.DeviceCount(); i++){
+            const uint64_t* column = trace.Power(i);
+            for (size_t j = 0; j < trace.SampleCount(); j++) trace_sum += column[j];
+        }
+    }
+    double trace_read_ms = elapsedMs(start);
+
+    cout << samples << ",\t" << csv_write_ms << ",\t" << csv_read_ms << ",\t" << filesystem::file_size(csv_path) / 1000000.0
+        << ",\t" << trace_write_ms << ",\t" << trace_read_ms << ",\t" << filesystem::file_size(trace_path) / 1000000.0
+        << (csv_sum == trace_sum ? "" : "\t(MISMATCH)") << endl;
+}
+
+int main(int, char**) {
+    string path = (string)filesystem::temp_directory_path() + "/power-bench.csv";
+
+    cout << "Power sample storage with " << DEVICE_COUNT << " devices" << endl;
+    cout << "impl,\tsamples,\tappend [ms],\tstop [ms],\texport [ms]" << endl;
+
+    for (size_t samples : {1000, 5000, 20000}){
+        benchmarkLists(samples, path);
+    }
+    for (size_t samples : {1000, 5000, 20000, 100000, 1000000, 4000000}){
+        benchmarkStore(samples, path);
+    }
+
+    cout << endl << "retention,\tsamples,\tstart+stop [ms],\tcsv line [ms],\texport [ms]" << endl;
+    for (size_t samples : {100000, 1000000, 10000000}){
+        benchmarkSampler(samples, mb::TraceRetention::FULL, "full", path);
+        benchmarkSampler(samples, mb::TraceRetention::DECIMATED, "decimated", path);
+        benchmarkSampler(samples, mb::TraceRetention::OFF, "off", path);
+    }
+
+    string trace_path = (string)filesystem::temp_directory_path() + "/power-bench.mbt";
+    cout << endl << "samples,\tcsv write [ms],\tcsv read [ms],\tcsv [MB],\tbinary write [ms],\tbinary read [ms],\tbinary [MB]" << endl;
+    for (size_t samples : {1000, 100000, 1000000, 4000000}){
+        benchmarkFormats(samples, path, trace_path);
+    }
+
+    filesystem::remove(path);
+    filesystem::remove(trace_path);
+    return 0;
+}
\ No newline at end of file
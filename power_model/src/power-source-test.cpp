@@ -0,0 +1,175 @@
+#include <iostream>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <unistd.h>
+
+#include "power-wrappers/microbench-power-source-rapl.h"
+#include "power-wrappers/microbench-power-source-hwmon.h"
+
+using namespace std;
+
+// Checks the sysfs power sources against fake sysfs trees in a temporary directory.
+// The sources run on a manual clock, so every expected power value is exact.
+
+int failures = 0;
+
+void check(bool condition, string message){
+    cout << (condition ? "PASSED: " : "FAILED: ") << message << endl;
+    if (!condition) failures++;
+}
+
+void writeValue(filesystem::path path, string value){
+    ofstream(path, ios_base::out | ios_base::trunc) << value << endl;
+}
+
+template <typename Source>
+class ManualClock : public Source{
+    public:
+        long Clock = 0;
+
+        ManualClock(string root) : Source(root){}
+
+        long Now(){
+            return Clock;
+        }
+};
+
+void testRapl(filesystem::path root){
+    // Package with a small counter range and a core subzone that stays idle
+    filesystem::path package = root / "intel-rapl:0";
+    filesystem::path core = root / "intel-rapl:0:0";
+    filesystem::create_directories(package);
+    filesystem::create_directories(core);
+    writeValue(package / "name", "package-0");
+    writeValue(package / "energy_uj", "1000000");
+    writeValue(package / "max_energy_range_uj", "9999999");
+    writeValue(core / "name", "core");
+    writeValue(core / "energy_uj", "500");
+
+    ManualClock<mb::RaplPowerSource> source(root);
+    check(source.DeviceCount() == 2, "rapl finds both zones");
+    check(source.DeviceName(0) == "rapl=package-0", "rapl names the package");
+    check(source.DeviceName(1) == "rapl=package-0/core", "rapl names the subzone with its package");
+
+    uint64_t power[2];
+    source.Clock = 0;
+    source.Reset();
+
+    // 2 J in 1 s
+    writeValue(package / "energy_uj", "3000000");
+    source.Clock = 1000000000;
+    source.Measure(power);
+    check(power[0] == 2000000, "rapl averages the power since the previous sample");
+    check(power[1] == 0, "rapl reports 0 W for an idle zone");
+
+    // 9999999 - 3000000 + 500000 + 1 uJ in 1 s
+    writeValue(package / "energy_uj", "500000");
+    source.Clock = 2000000000;
+    source.Measure(power);
+    check(power[0] == 7500000, "rapl counts the wrap at max_energy_range_uj");
+
+    double energy[2];
+    check(source.ReadEnergy(energy) && energy[0] == 9.5, "rapl accumulates the energy across the wrap");
+
+    // 4 J between two runs must not show up in the first sample of the next run
+    writeValue(package / "energy_uj", "4500000");
+    source.Clock = 10000000000;
+    source.Reset();
+    writeValue(package / "energy_uj", "5500000");
+    source.Clock = 11000000000;
+    source.Measure(power);
+    check(power[0] == 1000000, "rapl averages from the reset on");
+    check(source.ReadEnergy(energy) && energy[0] == 14.5, "rapl keeps the energy before the reset");
+}
+
+void testRaplWithoutRange(filesystem::path root){
+    filesystem::path package = root / "intel-rapl:0";
+    filesystem::create_directories(package);
+    writeValue(package / "name", "package-0");
+    writeValue(package / "energy_uj", "3000000");
+
+    ManualClock<mb::RaplPowerSource> source(root);
+    uint64_t power[1];
+    source.Clock = 0;
+    source.Reset();
+
+    // Without max_energy_range_uj a smaller value is a reset, not a wrap at 2^64
+    writeValue(package / "energy_uj", "1000000");
+    source.Clock = 1000000000;
+    source.Measure(power);
+    check(power[0] == 0, "rapl without a range takes a smaller value as a reset");
+
+    writeValue(package / "energy_uj", "2000000");
+    source.Clock = 2000000000;
+    source.Measure(power);
+    check(power[0] == 1000000, "rapl without a range counts on after the reset");
+}
+
+void testHwmon(filesystem::path root){
+    // GPU with an averaged power sensor and an energy counter, a CPU chip without power sensors
+    filesystem::path gpu = root / "hwmon10";
+    filesystem::path cpu = root / "hwmon2";
+    filesystem::create_directories(gpu);
+    filesystem::create_directories(cpu);
+    writeValue(gpu / "name", "amdgpu");
+    writeValue(gpu / "power1_average", "150000000");
+    writeValue(gpu / "power1_label", "PPT");
+    writeValue(gpu / "energy1_input", "1000000");
+    writeValue(cpu / "name", "coretemp");
+    writeValue(cpu / "temp1_input", "45000");
+
+    ManualClock<mb::HwmonPowerSource> source(root);
+    check(source.DeviceCount() == 2, "hwmon finds the power and the energy sensor");
+    check(source.DeviceName(0) == "hwmon=amdgpu:10/power1:PPT", "hwmon names the power sensor with its label");
+    check(source.DeviceName(1) == "hwmon=amdgpu:10/energy1", "hwmon names the energy sensor");
+
+    uint64_t power[2];
+    source.Clock = 0;
+    source.Reset();
+
+    // 3 J in 2 s
+    writeValue(gpu / "power1_average", "120000000");
+    writeValue(gpu / "energy1_input", "4000000");
+    source.Clock = 2000000000;
+    source.Measure(power);
+    check(power[0] == 120000000, "hwmon passes the power sensor through");
+    check(power[1] == 1500000, "hwmon averages the energy sensor since the previous sample");
+
+    // A smaller value is a driver reset, only the energy after it counts
+    writeValue(gpu / "energy1_input", "500000");
+    source.Clock = 3000000000;
+    source.Measure(power);
+    check(power[1] == 0, "hwmon does not count a counter reset as a wrap");
+
+    double energy[2];
+    check(source.ReadEnergy(energy) && isnan(energy[0]) && energy[1] == 3.0, "hwmon accumulates only the energy sensor");
+
+    // 5 J between two runs must not show up in the first sample of the next run
+    writeValue(gpu / "energy1_input", "5500000");
+    source.Clock = 10000000000;
+    source.Reset();
+    writeValue(gpu / "energy1_input", "6500000");
+    source.Clock = 12000000000;
+    source.Measure(power);
+    check(power[1] == 500000, "hwmon averages from the reset on");
+    check(source.ReadEnergy(energy) && energy[1] == 9.0, "hwmon keeps the energy before the reset");
+
+    mb::HwmonPowerSource filtered(root, {"PPT"});
+    check(filtered.DeviceCount() == 1 && filtered.DeviceName(0) == "hwmon=amdgpu:10/power1:PPT", "hwmon filters the sensors by label");
+}
+
+int main(){
+    filesystem::path root = filesystem::temp_directory_path() / ("power-source-test-" + to_string(getpid()));
+    filesystem::remove_all(root);
+
+    testRapl(root / "powercap");
+    testRaplWithoutRange(root / "powercap-without-range");
+    testHwmon(root / "hwmon");
+
+    filesystem::remove_all(root);
+    cout << (failures == 0 ? "All power source tests passed!" : to_string(failures) + " power source tests failed!") << endl;
+    return failures == 0 ? 0 : 1;
+}
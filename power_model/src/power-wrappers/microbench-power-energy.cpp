@@ -0,0 +1,56 @@
+#include "microbench-power-energy.h"
+
+using namespace mb;
+using namespace std;
+
+mb::EnergyCounters::EnergyCounters() : EnergyCounters(vector<uint64_t>()){}
+
+mb::EnergyCounters::EnergyCounters(vector<uint64_t> counter_ranges){
+    ranges = counter_ranges;
+    last_raw.assign(ranges.size(), 0);
+    accumulated.assign(ranges.size(), 0.0);
+    measured.assign(ranges.size(), 0.0);
+    last_timestamp = 0;
+    primed = false;
+}
+
+void mb::EnergyCounters::Update(const uint64_t* raw){
+    for (size_t i = 0; i < ranges.size(); i++){
+        if (raw[i] >= last_raw[i]){
+            accumulated[i] += raw[i] - last_raw[i];
+        } else if (ranges[i] > 0){
+            // The range is inclusive, the step from the range to 0 counts as well
+            accumulated[i] += ranges[i] - last_raw[i] + raw[i] + 1;
+        }
+        last_raw[i] = raw[i];
+    }
+}
+
+void mb::EnergyCounters::Reset(const uint64_t* raw, long timestamp){
+    // Energy since the previous read is kept in the accumulator, but not in the next sample
+    if (primed){
+        Update(raw);
+    } else {
+        last_raw.assign(raw, raw + ranges.size());
+        primed = true;
+    }
+    measured = accumulated;
+    last_timestamp = timestamp;
+}
+
+void mb::EnergyCounters::Measure(const uint64_t* raw, long timestamp, uint64_t* power){
+    Update(raw);
+
+    // uJ / s = uW
+    long time_dif = timestamp - last_timestamp;
+    for (size_t i = 0; i < ranges.size(); i++){
+        double energy_dif = accumulated[i] - measured[i];
+        power[i] = time_dif > 0 ? (uint64_t)(energy_dif * 1000000000 / time_dif) : 0;
+        measured[i] = accumulated[i];
+    }
+    last_timestamp = timestamp;
+}
+
+double mb::EnergyCounters::Energy(int counter){
+    return accumulated[counter] / 1000000;
+}
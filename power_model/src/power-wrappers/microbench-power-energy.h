@@ -0,0 +1,39 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+namespace mb{
+    // Cumulative energy counters in uJ as exposed by sysfs (RAPL energy_uj, hwmon energy*_input),
+    // extended across wraps and turned into the average power between two samples
+    class EnergyCounters{
+        public:
+            EnergyCounters();
+
+            // Largest raw value of every counter before it wraps around to 0. A range of 0 means
+            // the counter has no documented range, a smaller value is a reset of the driver then.
+            EnergyCounters(std::vector<uint64_t> ranges);
+
+            // Fold the raw values into the accumulated energy
+            void Update(const uint64_t* raw);
+
+            // Start the averaging window of the next Measure() at timestamp (ns). The first call
+            // primes the counters, so that the first sample already yields a power value.
+            void Reset(const uint64_t* raw, long timestamp);
+
+            // Average power of every counter since the previous Measure() or Reset() in uW
+            void Measure(const uint64_t* raw, long timestamp, uint64_t* power);
+
+            // Accumulated energy of a counter in J
+            double Energy(int counter);
+
+        private:
+            std::vector<uint64_t> ranges;
+            std::vector<uint64_t> last_raw;
+            std::vector<double> accumulated;
+            std::vector<double> measured;
+            long last_timestamp;
+            bool primed;
+    };
+}
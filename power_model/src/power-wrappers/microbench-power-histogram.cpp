@@ -0,0 +1,78 @@
+#include "microbench-power-histogram.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace mb;
+using namespace std;
+
+mb::LatencyHistogram::LatencyHistogram(){
+    // Enough buckets for every non-negative long
+    counts.assign((64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_HALF, 0);
+    Clear();
+}
+
+void mb::LatencyHistogram::Clear(){
+    fill(counts.begin(), counts.end(), 0);
+    count = 0;
+    max = 0;
+}
+
+void mb::LatencyHistogram::Record(long value){
+    value = value > 0 ? value : 0;
+    counts[index(value)]++;
+    count++;
+    max = value > max ? value : max;
+}
+
+size_t mb::LatencyHistogram::Count(){
+    return count;
+}
+
+long mb::LatencyHistogram::Max(){
+    return max;
+}
+
+long mb::LatencyHistogram::Percentile(double percentile){
+    if (count == 0) return 0;
+
+    size_t rank = (size_t)ceil(percentile / 100 * count);
+    rank = rank > 0 ? rank : 1;
+
+    size_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++){
+        seen += counts[i];
+        if (seen >= rank) return BucketUpper(i) < max ? BucketUpper(i) : max;
+    }
+    return max;
+}
+
+size_t mb::LatencyHistogram::BucketCount(){
+    return counts.size();
+}
+
+long mb::LatencyHistogram::BucketLower(size_t bucket){
+    if (bucket < 2 * SUB_BUCKET_HALF) return bucket;
+
+    int exponent = bucket / SUB_BUCKET_HALF - 1;
+    long sub_bucket = bucket - exponent * SUB_BUCKET_HALF;
+    return sub_bucket << exponent;
+}
+
+long mb::LatencyHistogram::BucketUpper(size_t bucket){
+    if (bucket < 2 * SUB_BUCKET_HALF) return bucket;
+
+    int exponent = bucket / SUB_BUCKET_HALF - 1;
+    return BucketLower(bucket) + (1L << exponent) - 1;
+}
+
+size_t mb::LatencyHistogram::BucketValue(size_t bucket){
+    return counts[bucket];
+}
+
+size_t mb::LatencyHistogram::index(long value){
+    if (value < 2 * SUB_BUCKET_HALF) return value;
+
+    // Keep the SUB_BUCKET_BITS most significant bits of the value
+    int exponent = 63 - __builtin_clzl(value) - (SUB_BUCKET_BITS - 1);
+    return exponent * SUB_BUCKET_HALF + (value >> exponent);
+}
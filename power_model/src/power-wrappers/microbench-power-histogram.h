@@ -0,0 +1,39 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+namespace mb{
+    // Fixed-bucket latency histogram in ns (HDR style): exact below 64 ns, above
+    // that every power of two is split into 32 linear buckets (< 3.2 % error).
+    // All buckets are allocated up front, recording never allocates.
+    class LatencyHistogram{
+        public:
+            LatencyHistogram();
+
+            void Clear();
+            void Record(long value);
+
+            size_t Count();
+            long Max();
+
+            // Upper bound of the bucket holding the given percentile (0..100), capped at Max()
+            long Percentile(double percentile);
+
+            size_t BucketCount();
+            long BucketLower(size_t bucket);
+            long BucketUpper(size_t bucket);
+            size_t BucketValue(size_t bucket);
+
+        private:
+            static const int SUB_BUCKET_BITS = 6;
+            static const long SUB_BUCKET_HALF = 1L << (SUB_BUCKET_BITS - 1);
+
+            std::vector<size_t> counts;
+            size_t count;
+            long max;
+
+            size_t index(long value);
+    };
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include "microbench-power-source.h"
+#include "microbench-power-energy.h"
+
+namespace mb{
+    // Linux hwmon power and energy sensors, e.g. /sys/class/hwmon/hwmon2/power1_average.
+    // Every power*_input (or power*_average if there is no input), and every energy*_input
+    // becomes one device, labeled by chip, sensor and power*_label, e.g. hwmon=amdgpu:2/power1:PPT.
+    // Sensors can be restricted to labels (or sensor names) containing one of the given filters.
+    class HwmonPowerSource : public PowerSource{
+        public:
+            HwmonPowerSource(std::string root = "/sys/class/hwmon", std::vector<std::string> filters = {});
+            ~HwmonPowerSource();
+
+            int DeviceCount();
+            std::string DeviceName(int device);
+            void Measure(uint64_t* power);
+            bool ReadEnergy(double* energy);
+            void Reset();
+
+        private:
+            std::vector<std::string> names;
+            std::vector<std::string> paths;
+            std::vector<int> files;
+
+            // Raw values of the last pass in uW (power) or uJ (energy), every
+            // value is held if its sensor cannot be read on a tick
+            std::vector<uint64_t> values;
+            std::vector<bool> warned;
+
+            // Devices of the energy sensors, their raw values and average power
+            std::vector<int> energy_devices;
+            std::vector<uint64_t> energy_values;
+            std::vector<uint64_t> energy_power;
+            EnergyCounters counters;
+
+            void readValues();
+            void addSensor(std::string path, std::string name, bool energy);
+    };
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include "microbench-power-source.h"
+#include "microbench-power-energy.h"
+
+namespace mb{
+    // Linux powercap (RAPL) energy counters, e.g. /sys/class/powercap/intel-rapl:0/energy_uj.
+    // Every zone (package, core, uncore, dram, psys) becomes one device.
+    class RaplPowerSource : public PowerSource{
+        public:
+            RaplPowerSource(std::string root = "/sys/class/powercap");
+            ~RaplPowerSource();
+
+            int DeviceCount();
+            std::string DeviceName(int device);
+            void Measure(uint64_t* power);
+            bool ReadEnergy(double* energy);
+
+            // The first sample after Reset averages from the reset on, not from the previous run
+            void Reset();
+
+        private:
+            std::vector<std::string> names;
+            std::vector<std::string> paths;
+            std::vector<int> energy_files;
+
+            // Raw counters of the last read in uJ
+            std::vector<uint64_t> raw_energy;
+            EnergyCounters counters;
+
+            void readEnergy(uint64_t* energy);
+            uint64_t readValue(int file, std::string path);
+    };
+}
\ No newline at end of file
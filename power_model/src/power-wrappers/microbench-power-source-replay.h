@@ -0,0 +1,90 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <utility>
+
+#include "microbench-power-source.h"
+
+namespace mb{
+    // Hardware-free source on its own time base. A speed of 1 plays back in real
+    // time and larger values accelerate. A speed of 0 runs on a virtual clock:
+    // every sample lands exactly on its deadline without sleeping and the whole
+    // trace is recorded before Stop() returns, so results are bit-identical
+    // between runs and machines.
+    class TracePowerSource : public PowerSource{
+        public:
+            TracePowerSource(float speed = 0);
+
+            void Measure(uint64_t* power);
+            void Reset();
+            long Now();
+            std::string ClockName();
+            bool SleepUntil(long deadline);
+            bool Pending();
+
+        protected:
+            float speed;
+            long start;
+            long virtual_now;
+            long end;
+
+            // Power of all devices at the given time since the start of the trace in ns
+            virtual void measureAt(long time, uint64_t* power) = 0;
+            long traceTime();
+            long monotonicNow();
+    };
+
+    // Replays a power trace written by PowerWrapper::WritePowerCsv or
+    // PowerWrapper::WritePowerTrace (sample and hold)
+    class ReplayPowerSource : public TracePowerSource{
+        public:
+            ReplayPowerSource(std::string path, float speed = 0);
+
+            int DeviceCount();
+            std::string DeviceName(int device);
+            void Reset();
+
+        private:
+            std::vector<std::string> names;
+            std::vector<long> timestamps;
+            std::vector<uint64_t> power_values;
+            size_t position;
+
+            void measureAt(long time, uint64_t* power);
+    };
+
+    // Piecewise linear power profile in W over time in s with optional gaussian noise
+    class SyntheticProfile{
+        public:
+            int Devices;
+            double Noise;
+            unsigned Seed;
+            std::vector<std::pair<double, double>> Points;
+
+            SyntheticProfile(int devices = 1, double noise = 0.0, unsigned seed = 0);
+
+            // Jump to the power at the given time
+            void Step(double time, double watts);
+
+            // Change linearly from the previous point to the power at the given time
+            void Ramp(double time, double watts);
+    };
+
+    class SyntheticPowerSource : public TracePowerSource{
+        public:
+            SyntheticPowerSource(SyntheticProfile profile, float speed = 0);
+
+            int DeviceCount();
+            std::string DeviceName(int device);
+            void Reset();
+
+        private:
+            SyntheticProfile profile;
+            std::mt19937 generator;
+            std::normal_distribution<double> noise;
+
+            void measureAt(long time, uint64_t* power);
+    };
+}
\ No newline at end of file
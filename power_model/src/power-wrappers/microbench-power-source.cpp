@@ -0,0 +1,13 @@
+#include "microbench-power-source.h"
+#include <iostream>
+
+using namespace mb;
+using namespace std;
+
+shared_ptr<PowerSource> mb::PowerSourceRegistry::Create(string name, string config){
+    if (!Contains(name)){
+        cout << "ERROR: The power source " << name << " is not available in this binary!" << endl;
+        exit(1);
+    }
+    return Registry::Create(name, config);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <iostream>
+#include <cstdint>
+#include <memory>
+#include <time.h>
+#include <errno.h>
+
+#include "microbench-registry.h"
+
+namespace mb{
+    // A device-level power reading backend used by the PowerWrapper sampler
+    class PowerSource{
+        public:
+            virtual ~PowerSource(){}
+
+            // Number of power columns this source delivers per sample
+            virtual int DeviceCount() = 0;
+
+            // Column label, e.g. "device=0", used in all CSV headers
+            virtual std::string DeviceName(int device) = 0;
+
+            // Write the current power of every device in microwatts
+            virtual void Measure(uint64_t* power) = 0;
+
+            // Cumulative energy of every device in J since an arbitrary origin,
+            // extended across counter wraparounds. Devices without a hardware
+            // accumulator are set to NaN; returns false if no device has one.
+            virtual bool ReadEnergy(double*){
+                return false;
+            }
+
+            // Called by PowerWrapper::Start before the first sample
+            virtual void Reset(){}
+
+            // Clock of the sampler in ns. Hardware sources use CLOCK_MONOTONIC,
+            // replay sources may run on a virtual clock instead.
+            virtual long Now(){
+                timespec ts;
+                clock_gettime(CLOCK_MONOTONIC, &ts);
+                return ts.tv_sec * 1000000000 + ts.tv_nsec;
+            }
+
+            // Name of the clock behind Now(), recorded in binary traces
+            virtual std::string ClockName(){
+                return "CLOCK_MONOTONIC";
+            }
+
+            // Block until the absolute deadline of Now(). Returns false if no
+            // sample is due (e.g. a replayed trace has ended).
+            virtual bool SleepUntil(long deadline){
+                timespec ts = {deadline / 1000000000, deadline % 1000000000};
+                while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR);
+                return true;
+            }
+
+            // True while the source still has samples that have to be recorded
+            // before the sampler may stop, even if Stop() was already requested
+            virtual bool Pending(){
+                return false;
+            }
+    };
+
+    // Cumulative event counters (e.g. PAPI event sets) read by the sampler thread
+    // on its tick, so they share the timeline of the power samples
+    class CounterSource{
+        public:
+            virtual ~CounterSource(){}
+
+            // Fixed for one run, queried at PowerWrapper::Start
+            virtual int CounterCount() = 0;
+            virtual std::string CounterName(int counter) = 0;
+
+            // Write the counter values since the start of the run
+            virtual void Read(uint64_t* values) = 0;
+    };
+
+    // Backend names ("amd", "rapl", ...), the config string is backend specific,
+    // e.g. the sysfs root for rapl
+    class PowerSourceRegistry : public Registry<PowerSource, std::string>{
+        public:
+            // Exits if the source is not linked into the binary
+            static std::shared_ptr<PowerSource> Create(std::string name, std::string config = "");
+    };
+
+    typedef PowerSourceRegistry::Registration PowerSourceRegistration;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "microbench-power-statistics.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace mb;
+using namespace std;
+
+mb::PowerStatistics::PowerStatistics() : PowerStatistics(0){}
+
+mb::PowerStatistics::PowerStatistics(int devices){
+    device_count = devices;
+
+    mean.assign(device_count, 0.0);
+    m2.assign(device_count, 0.0);
+    min.assign(device_count, 0);
+    max.assign(device_count, 0);
+    last_power.assign(device_count, 0);
+    energy.assign(device_count, 0.0);
+
+    Clear();
+}
+
+void mb::PowerStatistics::Clear(){
+    count = 0;
+    weight_sum = 0.0;
+    first_timestamp = 0;
+    last_timestamp = 0;
+
+    fill(mean.begin(), mean.end(), 0.0);
+    fill(m2.begin(), m2.end(), 0.0);
+    fill(min.begin(), min.end(), UINT64_MAX);
+    fill(max.begin(), max.end(), 0);
+    fill(last_power.begin(), last_power.end(), 0);
+    fill(energy.begin(), energy.end(), 0.0);
+}
+
+void mb::PowerStatistics::Add(long timestamp, const uint64_t* power, double weight){
+    count++;
+    weight_sum += weight;
+    if (count == 1) first_timestamp = timestamp;
+    long time_dif = timestamp - last_timestamp;
+
+    for (int i = 0; i < device_count; i++){
+        double value = power[i];
+
+        // Weighted Welford update (West) of mean and sum of squared deviations
+        double delta = value - mean[i];
+        mean[i] += delta * weight / weight_sum;
+        m2[i] += weight * delta * (value - mean[i]);
+
+        min[i] = power[i] < min[i] ? power[i] : min[i];
+        max[i] = power[i] > max[i] ? power[i] : max[i];
+
+        // Trapezoid between the previous and this sample
+        if (count > 1) energy[i] += ((double)last_power[i] + value) / 2 * time_dif;
+        last_power[i] = power[i];
+    }
+    last_timestamp = timestamp;
+}
+
+size_t mb::PowerStatistics::Count(){
+    return count;
+}
+
+double mb::PowerStatistics::Duration(){
+    return (last_timestamp - first_timestamp) / 1000000000.0;
+}
+
+double mb::PowerStatistics::Energy(int device){
+    return energy[device] / 1e15;
+}
+
+double mb::PowerStatistics::Mean(int device){
+    return mean[device] / 1000000;
+}
+
+double mb::PowerStatistics::Variance(int device){
+    // Population variance (as np.var, weighted by ticks) in W^2
+    return weight_sum > 0 ? m2[device] / weight_sum / 1e12 : 0.0;
+}
+
+double mb::PowerStatistics::Std(int device){
+    return sqrt(Variance(device));
+}
+
+double mb::PowerStatistics::Min(int device){
+    return count > 0 ? min[device] / 1000000.0 : 0.0;
+}
+
+double mb::PowerStatistics::Max(int device){
+    return count > 0 ? max[device] / 1000000.0 : 0.0;
+}
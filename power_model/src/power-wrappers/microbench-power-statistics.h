@@ -0,0 +1,48 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+namespace mb{
+    // Streaming per-device statistics of a power trace. Every sample is folded
+    // into the accumulators on arrival, so the results are available in O(1)
+    // after the run and do not depend on how much of the raw trace is kept.
+    class PowerStatistics{
+        public:
+            PowerStatistics();
+            PowerStatistics(int device_count);
+
+            void Clear();
+
+            // The weight is the number of sampler ticks the sample stands for, so mean
+            // and std stay time-weighted when the sampler backs off (adaptive mode)
+            void Add(long timestamp, const uint64_t* power, double weight = 1.0);
+
+            size_t Count();
+            double Duration();
+
+            // Power in W and energy in J of one device
+            double Energy(int device);
+            double Mean(int device);
+            double Variance(int device);
+            double Std(int device);
+            double Min(int device);
+            double Max(int device);
+
+        private:
+            int device_count;
+            size_t count;
+            double weight_sum;
+            long first_timestamp;
+            long last_timestamp;
+
+            // Welford accumulators and running trapezoid in uW and uW * ns
+            std::vector<double> mean;
+            std::vector<double> m2;
+            std::vector<uint64_t> min;
+            std::vector<uint64_t> max;
+            std::vector<uint64_t> last_power;
+            std::vector<double> energy;
+    };
+}
@@ -0,0 +1,230 @@
+#include "microbench-power-store.h"
+#include <iostream>
+#include <fstream>
+#include <charconv>
+#include <algorithm>
+#include <cmath>
+
+using namespace mb;
+using namespace std;
+
+mb::PowerMarker::PowerMarker(long timestamp, string label){
+    Timestamp = timestamp;
+    Label = label;
+}
+
+mb::PowerStore::PowerStore() : PowerStore(0, 0){}
+
+mb::PowerStore::PowerStore(int devices, size_t cap, OverflowPolicy overflow, size_t chunk){
+    device_count = devices;
+    capacity = cap;
+    growth = chunk;
+    policy = overflow;
+
+    // Allocate (and touch) all columns once, the sampler thread only writes into them
+    timestamps.assign(capacity, 0);
+    power_values.assign(capacity * device_count, 0);
+
+    Clear();
+}
+
+void mb::PowerStore::Clear(){
+    head = 0;
+    count = 0;
+    dropped = 0;
+}
+
+void mb::PowerStore::Append(long timestamp, const uint64_t* power){
+    if (count == capacity && growth > 0 && policy == OverflowPolicy::DISCARD_NEWEST) grow();
+    if (capacity == 0){
+        dropped++;
+        return;
+    }
+
+    size_t index;
+    if (count < capacity){
+        index = slot(count);
+        count++;
+    } else if (policy == OverflowPolicy::OVERWRITE_OLDEST){
+        index = head;
+        head = (head + 1) % capacity;
+        dropped++;
+    } else {
+        dropped++;
+        return;
+    }
+
+    timestamps[index] = timestamp;
+    for (int i = 0; i < device_count; i++){
+        power_values[i * capacity + index] = power[i];
+    }
+}
+
+int mb::PowerStore::DeviceCount(){
+    return device_count;
+}
+
+size_t mb::PowerStore::Size(){
+    return count;
+}
+
+size_t mb::PowerStore::Capacity(){
+    return capacity;
+}
+
+size_t mb::PowerStore::Dropped(){
+    return dropped;
+}
+
+OverflowPolicy mb::PowerStore::Policy(){
+    return policy;
+}
+
+void mb::PowerStore::grow(){
+    // The columns are laid out back to back, so every device column moves to its new offset
+    size_t extended = capacity + growth;
+    timestamps.resize(extended, 0);
+    vector<uint64_t> values(extended * device_count, 0);
+    for (int i = 0; i < device_count; i++){
+        copy(power_values.begin() + i * capacity, power_values.begin() + (i + 1) * capacity, values.begin() + i * extended);
+    }
+    power_values.swap(values);
+    capacity = extended;
+}
+
+long mb::PowerStore::Timestamp(size_t sample){
+    return timestamps[slot(sample)];
+}
+
+uint64_t mb::PowerStore::Power(int device, size_t sample){
+    return power_values[device * capacity + slot(sample)];
+}
+
+vector<pair<const void*, size_t>> mb::PowerStore::Segments(int column){
+    const char* base = column < 0
+        ? (const char*)timestamps.data()
+        : (const char*)(power_values.data() + column * capacity);
+    size_t element = column < 0 ? sizeof(long) : sizeof(uint64_t);
+
+    // Oldest samples from head to the end of the column, then the wrapped part
+    size_t first = min(count, capacity - head);
+    return {
+        {base + head * element, first * element},
+        {base, (count - first) * element}
+    };
+}
+
+double mb::PowerStore::Duration(){
+    if (count == 0) return 0.0;
+    return (Timestamp(count - 1) - Timestamp(0)) / 1000000000.0;
+}
+
+double mb::PowerStore::Energy(int device){
+    if (count < 2) return 0.0;
+
+    // Trapezoid in uW * ns, walking the columns once
+    double device_energy = 0.0;
+    double p1 = Power(device, 0);
+    long t1 = Timestamp(0);
+    for (size_t j = 1; j < count; j++){
+        double p2 = Power(device, j);
+        long t2 = Timestamp(j);
+
+        device_energy += (p1 + p2) / 2 * (t2 - t1);
+
+        p1 = p2;
+        t1 = t2;
+    }
+    return device_energy / 1e15;
+}
+
+double mb::PowerStore::Energy(int device, long from, long to){
+    if (count == 0 || from < Timestamp(0) || to > Timestamp(count - 1)) return NAN;
+    if (to <= from) return 0.0;
+
+    // Trapezoid over every segment clipped to [from, to] in uW * ns
+    double device_energy = 0.0;
+    for (size_t j = 1; j < count; j++){
+        long t1 = Timestamp(j - 1);
+        long t2 = Timestamp(j);
+        if (t2 <= from || t2 == t1) continue;
+        if (t1 >= to) break;
+
+        double p1 = Power(device, j - 1);
+        double p2 = Power(device, j);
+        long a = t1 > from ? t1 : from;
+        long b = t2 < to ? t2 : to;
+        double pa = p1 + (p2 - p1) * (a - t1) / (t2 - t1);
+        double pb = p1 + (p2 - p1) * (b - t1) / (t2 - t1);
+        device_energy += (pa + pb) / 2 * (b - a);
+    }
+    return device_energy / 1e15;
+}
+
+void mb::PowerStore::WriteCsv(std::string path, std::vector<std::string> names, std::vector<PowerMarker> markers){
+    // Input header, devices are labeled by their source (default: device=<index>)
+    string buffer = "id,timestamp,";
+    for (int i = 0; i < device_count; i++){
+        buffer += "power:" + (i < (int)names.size() ? names[i] : "device=" + to_string(i)) + ",";
+    }
+    if (markers.size() > 0) buffer += "marker,";
+    buffer.back() = '\n';
+
+    sort(markers.begin(), markers.end(), [](PowerMarker const& a, PowerMarker const& b){ return a.Timestamp < b.Timestamp; });
+    size_t marker_size = 0;
+    // Worst case: every label quoted on its own line with all characters escaped
+    for (PowerMarker const& marker : markers) marker_size += 2 * marker.Label.size() + 3;
+
+    // Format all lines into one buffer (at most 21 characters per column)
+    size_t header_size = buffer.size();
+    buffer.resize(header_size + count * (device_count + 3) * 21 + marker_size);
+    char* pos = buffer.data() + header_size;
+    char* end = buffer.data() + buffer.size();
+
+    size_t next_marker = 0;
+    for (size_t j = 0; j < count; j++){
+        pos = to_chars(pos, end, j).ptr;
+        *pos++ = ',';
+        pos = to_chars(pos, end, Timestamp(j)).ptr;
+
+        for (int i = 0; i < device_count; i++){
+            *pos++ = ',';
+            pos = to_chars(pos, end, Power(i, j)).ptr;
+        }
+        if (markers.size() > 0){
+            *pos++ = ',';
+            string field;
+            bool first = true;
+            while (next_marker < markers.size() && (markers[next_marker].Timestamp <= Timestamp(j) || j + 1 == count)){
+                if (!first) field += ';';
+                field += markers[next_marker].Label;
+                first = false;
+                next_marker++;
+            }
+
+            // Quoted as in RFC 4180 if a label contains a separator, a quote or a line break
+            if (field.find_first_of(",\"\r\n") == string::npos){
+                pos = copy(field.begin(), field.end(), pos);
+            } else {
+                *pos++ = '"';
+                for (char c : field){
+                    if (c == '"') *pos++ = '"';
+                    *pos++ = c;
+                }
+                *pos++ = '"';
+            }
+        }
+        *pos++ = '\n';
+    }
+    buffer.resize(pos - buffer.data());
+
+    // Single bulk write instead of a flush per line
+    ofstream csv_file(path, ios_base::out | ios_base::binary);
+    csv_file.write(buffer.data(), buffer.size());
+    csv_file.close();
+}
+
+size_t mb::PowerStore::slot(size_t sample){
+    size_t index = head + sample;
+    return index < capacity ? index : index - capacity;
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <utility>
+
+namespace mb{
+    // Behaviour of the store once all preallocated slots are in use
+    enum OverflowPolicy {
+        DISCARD_NEWEST,     // Keep the first samples of the run and count the rest as dropped
+        OVERWRITE_OLDEST    // Ring buffer, keep the most recent samples of the run
+    };
+
+    // Event on the sampler clock (e.g. a kernel start), written alongside the trace
+    class PowerMarker{
+        public:
+            long Timestamp;
+            std::string Label;
+
+            PowerMarker(long timestamp, std::string label);
+    };
+
+    // Column-oriented sample storage. All memory of the capacity is allocated up
+    // front, so appending from the sampler thread does not allocate until the
+    // capacity is exhausted. With a growth > 0 a full DISCARD_NEWEST store is
+    // extended by that many samples instead of dropping them.
+    class PowerStore{
+        public:
+            PowerStore();
+            PowerStore(int device_count, size_t capacity, OverflowPolicy policy = OverflowPolicy::DISCARD_NEWEST, size_t growth = 0);
+
+            void Clear();
+            void Append(long timestamp, const uint64_t* power);
+
+            int DeviceCount();
+            size_t Size();
+            size_t Capacity();
+            size_t Dropped();
+            OverflowPolicy Policy();
+
+            long Timestamp(size_t sample);
+            uint64_t Power(int device, size_t sample);
+
+            // Memory of one column in sample order as (pointer, bytes), two
+            // segments if the ring has wrapped. Column -1 are the timestamps.
+            std::vector<std::pair<const void*, size_t>> Segments(int column);
+
+            double Duration();
+            double Energy(int device);
+
+            // Energy between two timestamps, power is interpolated linearly at the
+            // borders. NaN if the stored samples do not cover the interval.
+            double Energy(int device, long from, long to);
+
+            // Markers are attached to the first sample at or after their timestamp
+            // in an additional marker column. Labels of one sample are joined by ';',
+            // the column is quoted if a label contains a comma, a quote or a line break.
+            void WriteCsv(std::string path, std::vector<std::string> names = {}, std::vector<PowerMarker> markers = {});
+
+        private:
+            int device_count;
+            size_t capacity;
+            size_t growth;
+            OverflowPolicy policy;
+
+            size_t head;
+            size_t count;
+            size_t dropped;
+
+            std::vector<long> timestamps;
+            std::vector<uint64_t> power_values;
+
+            size_t slot(size_t sample);
+            void grow();
+    };
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "microbench-power-thread.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+using namespace mb;
+using namespace std;
+
+mb::ThreadPlacement::ThreadPlacement(vector<int> cpus, int priority, int nice){
+    Cpus = cpus;
+    Priority = priority;
+    Nice = nice;
+}
+
+void mb::ThreadPlacement::Apply(string name){
+    if (Cpus.size() > 0){
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : Cpus) CPU_SET(cpu, &set);
+
+        int retval = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (retval != 0){
+            warn("Cannot pin the " + name + " thread: " + strerror(retval));
+        }
+    }
+
+    if (Priority > 0){
+        sched_param param = {};
+        param.sched_priority = Priority;
+
+        int retval = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (retval != 0){
+            warn("Cannot run the " + name + " thread with SCHED_FIFO priority " + to_string(Priority) + ": " + strerror(retval));
+        }
+    }
+
+    // On Linux the nice level of a thread id only affects that thread
+    if (Nice != 0){
+        if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), Nice) != 0){
+            warn("Cannot set the nice level of the " + name + " thread to " + to_string(Nice) + ": " + strerror(errno));
+        }
+    }
+}
+
+bool mb::ThreadPlacement::IsDefault(){
+    return Cpus.size() == 0 && Priority == 0 && Nice == 0;
+}
+
+void mb::ThreadPlacement::warn(string message){
+    // Placements are reapplied on every run, report each problem only once
+    if (!warned) cout << "WARNING: " << message << endl;
+    warned = true;
+}
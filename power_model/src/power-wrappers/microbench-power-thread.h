@@ -0,0 +1,28 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+
+namespace mb{
+    // CPU affinity and scheduling of a host thread (sampler or kernel submission).
+    // The defaults leave the thread untouched.
+    class ThreadPlacement{
+        public:
+            std::vector<int> Cpus;  // Allowed cores, empty keeps the inherited affinity
+            int Priority;           // SCHED_FIFO priority 1..99, 0 keeps the default policy
+            int Nice;               // Nice level -20..19 of the thread
+
+            ThreadPlacement(std::vector<int> cpus = {}, int priority = 0, int nice = 0);
+
+            // Apply to the calling thread. Missing permissions (CAP_SYS_NICE)
+            // only warn once, the measurement still runs with the default scheduling.
+            void Apply(std::string name);
+            bool IsDefault();
+
+        private:
+            bool warned = false;
+
+            void warn(std::string message);
+    };
+}
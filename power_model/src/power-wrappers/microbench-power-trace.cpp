@@ -0,0 +1,279 @@
+#include "microbench-power-trace.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstddef>
+#include <climits>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+using namespace mb;
+using namespace std;
+
+static const char TRACE_MAGIC[8] = "MBTRACE";
+static const uint32_t TRACE_VERSION = 2;
+
+static uint64_t align8(uint64_t offset){
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+mb::PowerTrace::PowerTrace(string trace_path){
+    path = trace_path;
+
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0){
+        cout << "Trace Error: Cannot open the power trace " << path << "!" << endl;
+        exit(1);
+    }
+    struct stat file_stat;
+    fstat(file, &file_stat);
+    size = file_stat.st_size;
+
+    if (size < offsetof(PowerTraceHeader, markers_offset)){
+        cout << "Trace Error: " << path << " is not a power trace!" << endl;
+        exit(1);
+    }
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED){
+        cout << "Trace Error: Cannot map the power trace " << path << "!" << endl;
+        exit(1);
+    }
+
+    header = (const PowerTraceHeader*)data;
+    if (memcmp(header->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 || header->version < 1 || header->version > TRACE_VERSION){
+        cout << "Trace Error: " << path << " is not a power trace of version 1 to " << TRACE_VERSION << "!" << endl;
+        exit(1);
+    }
+    if (header->power_offset + header->sample_count * header->device_count * sizeof(uint64_t) > size){
+        cout << "Trace Error: The power trace " << path << " is truncated!" << endl;
+        exit(1);
+    }
+    if (header->version >= 2 && header->markers_offset + header->marker_count * sizeof(PowerTraceMarker) > size){
+        cout << "Trace Error: The markers of the power trace " << path << " are truncated!" << endl;
+        exit(1);
+    }
+
+    string names_block((const char*)data + header->names_offset, header->names_size);
+    stringstream names_stream(names_block);
+    string name;
+    while (getline(names_stream, name)) names.push_back(name);
+}
+
+mb::PowerTrace::~PowerTrace(){
+    munmap(data, size);
+}
+
+int mb::PowerTrace::DeviceCount(){
+    return header->device_count;
+}
+
+size_t mb::PowerTrace::SampleCount(){
+    return header->sample_count;
+}
+
+string mb::PowerTrace::DeviceName(int device){
+    return device < (int)names.size() ? names[device] : "device=" + to_string(device);
+}
+
+string mb::PowerTrace::Clock(){
+    return string(header->clock, strnlen(header->clock, sizeof(header->clock)));
+}
+
+vector<PowerMarker> mb::PowerTrace::Markers(){
+    vector<PowerMarker> markers;
+    if (header->version < 2) return markers;
+
+    const PowerTraceMarker* records = (const PowerTraceMarker*)((const char*)data + header->markers_offset);
+    for (size_t i = 0; i < header->marker_count; i++){
+        markers.push_back(PowerMarker(records[i].timestamp, string(records[i].label, strnlen(records[i].label, sizeof(records[i].label)))));
+    }
+    return markers;
+}
+
+const int64_t* mb::PowerTrace::Timestamps(){
+    return (const int64_t*)((const char*)data + header->timestamps_offset);
+}
+
+const uint64_t* mb::PowerTrace::Power(int device){
+    return (const uint64_t*)((const char*)data + header->power_offset) + device * header->sample_count;
+}
+
+PowerStore mb::PowerTrace::ToStore(){
+    PowerStore store(DeviceCount(), SampleCount());
+    vector<uint64_t> power(DeviceCount());
+    for (size_t j = 0; j < SampleCount(); j++){
+        for (int i = 0; i < DeviceCount(); i++) power[i] = Power(i)[j];
+        store.Append(Timestamps()[j], power.data());
+    }
+    return store;
+}
+
+bool mb::PowerTrace::IsTrace(string path){
+    char magic[sizeof(TRACE_MAGIC)] = {};
+    ifstream(path, ios_base::binary).read(magic, sizeof(magic));
+    return memcmp(magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0;
+}
+
+void mb::PowerTrace::Write(string path, PowerStore& store, vector<string> names, string clock, vector<PowerMarker> markers){
+    int device_count = store.DeviceCount();
+    size_t sample_count = store.Size();
+
+    string names_block;
+    for (int i = 0; i < device_count; i++){
+        names_block += (i < (int)names.size() ? names[i] : "device=" + to_string(i)) + "\n";
+    }
+
+    PowerTraceHeader header = {};
+    memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header.version = TRACE_VERSION;
+    header.device_count = device_count;
+    header.sample_count = sample_count;
+    strncpy(header.timestamp_unit, "ns", sizeof(header.timestamp_unit) - 1);
+    strncpy(header.power_unit, "uW", sizeof(header.power_unit) - 1);
+    strncpy(header.clock, clock.c_str(), sizeof(header.clock) - 1);
+    header.names_offset = sizeof(PowerTraceHeader);
+    header.names_size = names_block.size();
+    header.timestamps_offset = align8(header.names_offset + header.names_size);
+    header.power_offset = header.timestamps_offset + sample_count * sizeof(int64_t);
+    header.markers_offset = header.power_offset + sample_count * device_count * sizeof(uint64_t);
+    header.marker_count = markers.size();
+    names_block.resize(header.timestamps_offset - header.names_offset, '\0');
+
+    // Labels longer than the record are truncated
+    vector<PowerTraceMarker> marker_records(markers.size());
+    size_t truncated = 0;
+    for (size_t i = 0; i < markers.size(); i++){
+        marker_records[i] = {};
+        marker_records[i].timestamp = markers[i].Timestamp;
+        strncpy(marker_records[i].label, markers[i].Label.c_str(), sizeof(marker_records[i].label) - 1);
+        if (markers[i].Label.size() >= sizeof(marker_records[i].label)) truncated++;
+    }
+    if (truncated > 0){
+        cout << "WARNING: " << truncated << " marker labels of the power trace " << path << " are truncated to "
+            << sizeof(PowerTraceMarker::label) - 1 << " characters!" << endl;
+    }
+
+    // Header, names and every column (two segments each if the ring has wrapped)
+    vector<iovec> segments;
+    segments.push_back({&header, sizeof(header)});
+    segments.push_back({names_block.data(), names_block.size()});
+    for (int column = -1; column < device_count; column++){
+        for (auto const& segment : store.Segments(column)){
+            if (segment.second > 0) segments.push_back({(void*)segment.first, segment.second});
+        }
+    }
+    if (marker_records.size() > 0){
+        segments.push_back({marker_records.data(), marker_records.size() * sizeof(PowerTraceMarker)});
+    }
+
+    int file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file < 0){
+        cout << "Trace Error: Cannot create the power trace " << path << "!" << endl;
+        exit(1);
+    }
+
+    // One gathered write, repeated only for partial writes or more than IOV_MAX segments
+    size_t index = 0;
+    while (index < segments.size()){
+        int segment_count = (int)min(segments.size() - index, (size_t)IOV_MAX);
+        ssize_t written = writev(file, segments.data() + index, segment_count);
+        if (written < 0){
+            cout << "Trace Error: Cannot write the power trace " << path << "!" << endl;
+            exit(1);
+        }
+        while (index < segments.size() && (size_t)written >= segments[index].iov_len){
+            written -= segments[index].iov_len;
+            index++;
+        }
+        if (written > 0){
+            segments[index].iov_base = (char*)segments[index].iov_base + written;
+            segments[index].iov_len -= written;
+        }
+    }
+    close(file);
+}
+
+PowerStore mb::ReadPowerCsv(string path, vector<string>& names){
+    vector<PowerMarker> markers;
+    return ReadPowerCsv(path, names, markers);
+}
+
+PowerStore mb::ReadPowerCsv(string path, vector<string>& names, vector<PowerMarker>& markers){
+    ifstream csv_file(path, ios_base::binary);
+    if (!csv_file.good()){
+        cout << "Trace Error: Cannot open the power trace " << path << "!" << endl;
+        exit(1);
+    }
+    string content((istreambuf_iterator<char>(csv_file)), istreambuf_iterator<char>());
+
+    // Header: id,timestamp,power:<device>,...[,marker]
+    size_t header_end = content.find('\n');
+    if (header_end == string::npos){
+        // Header only (or an empty file), the trace has no samples
+        header_end = content.size();
+    }
+    stringstream header(content.substr(0, header_end));
+    string column;
+    bool has_markers = false;
+    names.clear();
+    markers.clear();
+    for (int i = 0; getline(header, column, ','); i++){
+        if (!column.empty() && column.back() == '\r') column.pop_back();
+        if (column == "marker") has_markers = true;
+        else if (i >= 2) names.push_back(column.rfind("power:", 0) == 0 ? column.substr(6) : column);
+    }
+
+    // Lines are only an estimate of the samples (a quoted marker may span lines), the store grows if needed
+    size_t sample_count = 0;
+    for (size_t pos = header_end; pos != string::npos && pos + 1 < content.size(); pos = content.find('\n', pos + 1)){
+        if (content[pos + 1] != '\n') sample_count++;
+    }
+
+    PowerStore store(names.size(), sample_count, OverflowPolicy::DISCARD_NEWEST, 1024);
+    vector<uint64_t> power(names.size());
+    char* pos = content.data() + header_end;
+    char* end = content.data() + content.size();
+    while (pos < end){
+        while (pos < end && (*pos == '\n' || *pos == '\r')) pos++;
+        if (pos >= end) break;
+
+        strtoull(pos, &pos, 10);
+        long timestamp = strtol(pos + 1, &pos, 10);
+        for (size_t i = 0; i < names.size(); i++){
+            power[i] = strtoull(pos + 1, &pos, 10);
+        }
+        store.Append(timestamp, power.data());
+
+        // Marker labels separated by ';' up to the end of the line, a quoted field may span lines
+        char* line_end = find(pos, end, '\n');
+        if (has_markers && pos < line_end && *pos == ','){
+            string field;
+            pos++;
+            if (*pos == '"'){
+                for (pos++; pos < end; pos++){
+                    if (*pos == '"' && (pos + 1 == end || pos[1] != '"')) break;
+                    if (*pos == '"') pos++;
+                    field += *pos;
+                }
+                line_end = find(pos, end, '\n');
+            } else {
+                field = string(pos, line_end);
+                if (!field.empty() && field.back() == '\r') field.pop_back();
+            }
+
+            stringstream labels(field);
+            string label;
+            while (getline(labels, label, ';')){
+                if (!label.empty()) markers.push_back(PowerMarker(timestamp, label));
+            }
+        }
+        pos = line_end;
+    }
+    return store;
+}
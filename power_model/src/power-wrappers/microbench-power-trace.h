@@ -0,0 +1,80 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "microbench-power-store.h"
+
+namespace mb{
+    enum TraceFormat {
+        CSV,        // power_*.csv, one text line per sample
+        BINARY      // power_*.mbt, see PowerTraceHeader
+    };
+
+    // On-disk layout of a binary power trace (*.mbt), native byte order:
+    //   header | device names ('\n' separated, padded to 8 bytes)
+    //   | int64 timestamps[samples] | uint64 power[devices][samples]
+    //   | PowerTraceMarker markers[markers] (version 2)
+    // All offsets are absolute and 8-byte aligned, so a mapped file can be
+    // used in place without parsing.
+    struct PowerTraceHeader{
+        char magic[8];              // "MBTRACE"
+        uint32_t version;
+        uint32_t device_count;
+        uint64_t sample_count;
+        char timestamp_unit[8];     // "ns"
+        char power_unit[8];         // "uW"
+        char clock[32];             // e.g. "CLOCK_MONOTONIC" or "virtual"
+        uint64_t names_offset;
+        uint64_t names_size;
+        uint64_t timestamps_offset;
+        uint64_t power_offset;
+        uint64_t markers_offset;
+        uint64_t marker_count;
+    };
+
+    struct PowerTraceMarker{
+        int64_t timestamp;
+        char label[24];
+    };
+
+    // Read-only view of a binary trace mapped into memory
+    class PowerTrace{
+        public:
+            PowerTrace(std::string path);
+            ~PowerTrace();
+            PowerTrace(const PowerTrace&) = delete;
+            PowerTrace& operator=(const PowerTrace&) = delete;
+
+            int DeviceCount();
+            size_t SampleCount();
+            std::string DeviceName(int device);
+            std::string Clock();
+            std::vector<PowerMarker> Markers();
+
+            const int64_t* Timestamps();
+            const uint64_t* Power(int device);
+
+            // Copy into a store, e.g. to export it as CSV
+            PowerStore ToStore();
+
+            // True if the file starts with the binary trace magic
+            static bool IsTrace(std::string path);
+
+            // Write the columns of the store with a single gathered write
+            static void Write(std::string path, PowerStore& store, std::vector<std::string> names, std::string clock, std::vector<PowerMarker> markers = {});
+
+        private:
+            std::string path;
+            void* data;
+            size_t size;
+            const PowerTraceHeader* header;
+            std::vector<std::string> names;
+    };
+
+    // Load a power_*.csv as written by PowerStore::WriteCsv, markers get the timestamp of their sample
+    PowerStore ReadPowerCsv(std::string path, std::vector<std::string>& names);
+    PowerStore ReadPowerCsv(std::string path, std::vector<std::string>& names, std::vector<PowerMarker>& markers);
+}
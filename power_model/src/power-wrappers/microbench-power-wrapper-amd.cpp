@@ -1,20 +1,44 @@
-#include "microbench-power-wrapper.h"
+#include "microbench-power-source.h"
 #include <iostream>
-#include <chrono>
-#include <thread>
-#include <fstream>
+#include <memory>
+#include <vector>
+#include <cmath>
 
 #include <rocm_smi/rocm_smi.h>
 
 using namespace mb;
 using namespace std;
 
-mb::PowerWrapper::PowerWrapper(){};
+namespace mb{
+    // Power of all GPUs via ROCm SMI
+    class AmdPowerSource : public PowerSource{
+        public:
+            AmdPowerSource();
 
-mb::PowerWrapper::PowerWrapper(int interval){
-    cout << "Power Wrapper for AMD!" << endl;
+            int DeviceCount();
+            std::string DeviceName(int device);
+            void Measure(uint64_t* power);
+            bool ReadEnergy(double* energy);
+
+        private:
+            int device_count;
+
+            // Raw accumulator values of the last read and their sum in uJ,
+            // devices without an accumulator are marked as unsupported
+            std::vector<bool> energy_supported;
+            std::vector<uint64_t> last_energy;
+            std::vector<double> accumulated_energy;
 
-    loop_interval = interval;
+            void handleReturn(int retval);
+    };
+}
+
+static PowerSourceRegistration registration("amd", [](string){
+    return (shared_ptr<PowerSource>)make_shared<AmdPowerSource>();
+});
+
+mb::AmdPowerSource::AmdPowerSource(){
+    cout << "Power Wrapper for AMD!" << endl;
 
     handleReturn(rsmi_init(0));
 
@@ -23,156 +47,54 @@ mb::PowerWrapper::PowerWrapper(int interval){
     handleReturn(rsmi_num_monitor_devices(&num_devices));
     device_count = num_devices;
 
-    // Initialize data storage
-    power_measurement = new uint64_t[device_count]();
-    energy_measurement = new float[device_count]();
-    loop_power_values = new std::list<uint64_t>[device_count]();
-}
-
-void mb::PowerWrapper::Start(){
-    loop_cancel = false;            
-    for (int i = 0; i < device_count; i++)
-        loop_power_values[i].clear();                  
-    loop_timestamp_values.clear();
-    
-    addMeasurement();
-    loop_thread = thread(&PowerWrapper::loop, this);
-}
-
-void mb::PowerWrapper::Stop(){
-    loop_cancel = true;
-    loop_thread.join();
-
-    addMeasurement();
-    calculateDuration();
-    calculateEnergy();
-}
-
-void mb::PowerWrapper::Print(){
-    cout << "POWER COUNTERS: Measured for " << measurement_duration << " s and collected " << loop_timestamp_values.size() << " samples!" << endl;
+    // Probe the energy accumulators, older GPUs and drivers do not provide one
+    energy_supported.assign(device_count, false);
+    last_energy.assign(device_count, 0);
+    accumulated_energy.assign(device_count, 0.0);
     for (int i = 0; i < device_count; i++){
-        float energy_per_second = energy_measurement[i] / measurement_duration;
-
-        std::cout << "\tENERGY:device=" << i << ": " << energy_measurement[i] << " J => " << energy_per_second << " J/s" << std::endl;                
+        float resolution;
+        uint64_t timestamp;
+        energy_supported[i] = rsmi_dev_energy_count_get(i, &last_energy[i], &resolution, &timestamp) == RSMI_STATUS_SUCCESS;
     }
 }
 
-string mb::PowerWrapper::GetCsvHeader(){
-    string line_str = "duration,samples,";
-    
-    for (int i = 0; i < device_count; i++){
-        line_str += "ENERGY:device=" + to_string(i) + "," + "ENERGY_PER_SECOND:device=" + to_string(i) + ",";          
-    }
-
-    return line_str;
+int mb::AmdPowerSource::DeviceCount(){
+    return device_count;
 }
 
-string mb::PowerWrapper::GetCsvLine(){           
-    string line_str = to_string(measurement_duration) + "," + to_string(loop_timestamp_values.size()) + ",";
-    
-    for (int i = 0; i < device_count; i++){
-        float energy_per_second = energy_measurement[i] / measurement_duration;
-        line_str += to_string(energy_measurement[i]) + "," + to_string(energy_per_second) + ",";          
-    }
-
-    return line_str;
+string mb::AmdPowerSource::DeviceName(int device){
+    return "device=" + to_string(device);
 }
 
-void mb::PowerWrapper::WritePowerCsv(std::string path){
-    ofstream csv_file;
-    csv_file.open(path);
-
-    // Input header
-    string header = "id,timestamp,";
-    for (size_t i = 0; i < device_count; i++){
-        header += "power:device=" + to_string(i) + ",";
-    }
-    header.pop_back();
-    csv_file << header << endl;
-
-    // Input lines
-    int loop_count = loop_timestamp_values.size();
-    for (int j = 0; j < loop_count; j++){
-
-        auto t = *next(loop_timestamp_values.begin(), j);
-        string line = to_string(j) + "," + to_string(t) + ",";
-        
-        for (int i = 0; i < device_count; i++){
-            int p = *next(loop_power_values[i].begin(), j);
-            line += to_string(p) + ",";
-        }
-        line.pop_back();
-        csv_file << line << endl;
-    }
-
-    csv_file.close();
-}
-
-void mb::PowerWrapper::loop(){
-    if (!loop_cancel){
-        int duration = loop_interval - loopCallback();                
-        this_thread::sleep_for(std::chrono::microseconds(duration));                
-        loop();
+void mb::AmdPowerSource::Measure(uint64_t* power){
+    RSMI_POWER_TYPE type;
+    for (int i = 0; i < device_count; i++){        
+        handleReturn(rsmi_dev_power_get(i, &power[i], &type));
     }
 }
 
-int mb::PowerWrapper::loopCallback(){            
-    auto start = chrono::high_resolution_clock::now().time_since_epoch().count();
-    addMeasurement();    
-    auto stop = chrono::high_resolution_clock::now().time_since_epoch().count();            
-    return (stop - start) / 1000;
-}
-
-void mb::PowerWrapper::addMeasurement(){
-    measurePower();
-    auto timestamp = chrono::high_resolution_clock::now().time_since_epoch().count();
-
-    // Store measurement results
+bool mb::AmdPowerSource::ReadEnergy(double* energy){
+    bool any_supported = false;
     for (int i = 0; i < device_count; i++){
-        loop_power_values[i].push_back(power_measurement[i]);
-    }
-    loop_timestamp_values.push_back((long)timestamp);
-}
-
-void mb::PowerWrapper::calculateDuration(){
-    long t1 = loop_timestamp_values.front() / 1000000;
-    long t2 = loop_timestamp_values.back()  / 1000000;
-    measurement_duration = (float)(t2 - t1) / 1000;
-}
-
-void mb::PowerWrapper::calculateEnergy(){
-    int loop_count = loop_timestamp_values.size();
+        energy[i] = NAN;
+        if (!energy_supported[i]) continue;
 
-    for (int i = 0; i < device_count; i++)
-    {
-        float device_energy = 0.0;
-        
-        for (int j = 0; j < loop_count - 1; j++)
-        {
-            int p1 = *next(loop_power_values[i].begin(), j) / 1000000;
-            int p2 = *next(loop_power_values[i].begin(), j + 1) / 1000000;
+        uint64_t counter;
+        float resolution;
+        uint64_t timestamp;
+        handleReturn(rsmi_dev_energy_count_get(i, &counter, &resolution, &timestamp));
 
-            int t1 = *next(loop_timestamp_values.begin(), j) / 1000000;
-            int t2 = *next(loop_timestamp_values.begin(), j + 1) / 1000000;
+        // The accumulator counts in units of the resolution (uJ) and wraps at 64 bit
+        accumulated_energy[i] += (double)(counter - last_energy[i]) * resolution;
+        last_energy[i] = counter;
 
-            float time_dif = (float)(t2 - t1) / 1000;
-            int abs_dif = abs(p2 - p1);
-            int min_val = p1 < p2 ? p1 : p2;
-
-            device_energy += time_dif * min_val + (time_dif * abs_dif) / 2; 
-        }
-        energy_measurement[i] = device_energy;
-    }
-}
-
-void mb::PowerWrapper::measurePower(){
-    RSMI_POWER_TYPE* type = new RSMI_POWER_TYPE[device_count]();
-    for (int i = 0; i < device_count; i++){        
-        handleReturn(rsmi_dev_power_get(i, &power_measurement[i], &type[i]));
+        energy[i] = accumulated_energy[i] / 1000000;
+        any_supported = true;
     }
+    return any_supported;
 }
 
-void mb::PowerWrapper::handleReturn(int retval){
+void mb::AmdPowerSource::handleReturn(int retval){
     if (retval == RSMI_STATUS_NOT_SUPPORTED){
         cout << "ROCm SMI Error: Status not supported!" << endl;
         exit(1);
@@ -0,0 +1,188 @@
+#include "microbench-power-source-hwmon.h"
+#include <iostream>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <memory>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace mb;
+using namespace std;
+
+// Config: "<root>[,<label>...]", default root /sys/class/hwmon, only sensors whose
+// label contains one of the labels are sampled (all sensors without labels)
+static PowerSourceRegistration registration("hwmon", [](string config){
+    vector<string> tokens;
+    size_t start = 0;
+    while (true){
+        size_t separator = config.find(',', start);
+        tokens.push_back(config.substr(start, separator - start));
+        if (separator == string::npos) break;
+        start = separator + 1;
+    }
+
+    string root = tokens[0].empty() ? "/sys/class/hwmon" : tokens[0];
+    vector<string> filters(tokens.begin() + 1, tokens.end());
+    return (shared_ptr<PowerSource>)make_shared<HwmonPowerSource>(root, filters);
+});
+
+// Index of a file name like power1_average, -1 for other files
+static int sensorIndex(string file, string prefix, string suffix){
+    if (file.rfind(prefix, 0) != 0 || file.size() <= prefix.size() + suffix.size()) return -1;
+    if (file.compare(file.size() - suffix.size(), suffix.size(), suffix) != 0) return -1;
+    string number = file.substr(prefix.size(), file.size() - prefix.size() - suffix.size());
+    if (!all_of(number.begin(), number.end(), ::isdigit)) return -1;
+    return stoi(number);
+}
+
+mb::HwmonPowerSource::HwmonPowerSource(string root, vector<string> filters){
+    cout << "Power Wrapper for hwmon!" << endl;
+
+    if (!filesystem::is_directory(root)){
+        cout << "hwmon Error: The hwmon directory " << root << " does not exist!" << endl;
+        exit(1);
+    }
+
+    // Chips in numeric order, hwmon10 after hwmon9
+    vector<pair<int, string>> chips;
+    for (auto const& entry : filesystem::directory_iterator(root)){
+        string chip = entry.path().filename();
+        int index = sensorIndex(chip, "hwmon", "");
+        if (index >= 0) chips.push_back({index, chip});
+    }
+    sort(chips.begin(), chips.end());
+
+    for (auto const& [index, chip] : chips){
+        string path = root + "/" + chip;
+        string chip_name;
+        ifstream(path + "/name") >> chip_name;
+        if (chip_name.empty()) chip_name = "hwmon";
+
+        // Collect the sensor indices of the chip
+        vector<int> power_inputs;
+        vector<int> power_averages;
+        vector<int> energy_inputs;
+        for (auto const& entry : filesystem::directory_iterator(path)){
+            string file = entry.path().filename();
+            int sensor;
+            if ((sensor = sensorIndex(file, "power", "_input")) >= 0) power_inputs.push_back(sensor);
+            if ((sensor = sensorIndex(file, "power", "_average")) >= 0) power_averages.push_back(sensor);
+            if ((sensor = sensorIndex(file, "energy", "_input")) >= 0) energy_inputs.push_back(sensor);
+        }
+
+        // Instantaneous power where available, the driver average otherwise
+        vector<pair<int, string>> power_sensors;
+        for (int sensor : power_inputs) power_sensors.push_back({sensor, "_input"});
+        for (int sensor : power_averages){
+            if (find(power_inputs.begin(), power_inputs.end(), sensor) == power_inputs.end()) power_sensors.push_back({sensor, "_average"});
+        }
+        sort(power_sensors.begin(), power_sensors.end());
+        sort(energy_inputs.begin(), energy_inputs.end());
+
+        auto add = [&](string kind, int sensor, string suffix, bool energy){
+            string sensor_name = kind + to_string(sensor);
+            string label;
+            getline(ifstream(path + "/" + sensor_name + "_label"), label);
+            replace(label.begin(), label.end(), ',', ' ');
+
+            bool selected = filters.empty();
+            for (string const& filter : filters){
+                if (label.find(filter) != string::npos || sensor_name == filter) selected = true;
+            }
+            if (!selected) return;
+
+            string name = "hwmon=" + chip_name + ":" + to_string(index) + "/" + sensor_name + (label.empty() ? "" : ":" + label);
+            addSensor(path + "/" + sensor_name + suffix, name, energy);
+        };
+        for (auto const& [sensor, suffix] : power_sensors) add("power", sensor, suffix, false);
+        for (int sensor : energy_inputs) add("energy", sensor, "_input", true);
+    }
+
+    if (names.size() == 0){
+        cout << "hwmon Error: No power or energy sensors found in " << root << "!" << endl;
+        exit(1);
+    }
+
+    // hwmon energy counters do not wrap at a documented range
+    values.assign(names.size(), 0);
+    warned.assign(names.size(), false);
+    energy_values.assign(energy_devices.size(), 0);
+    energy_power.assign(energy_devices.size(), 0);
+    counters = EnergyCounters(vector<uint64_t>(energy_devices.size(), 0));
+    Reset();
+}
+
+mb::HwmonPowerSource::~HwmonPowerSource(){
+    for (int file : files) close(file);
+}
+
+int mb::HwmonPowerSource::DeviceCount(){
+    return names.size();
+}
+
+string mb::HwmonPowerSource::DeviceName(int device){
+    return names[device];
+}
+
+void mb::HwmonPowerSource::Measure(uint64_t* power){
+    readValues();
+    counters.Measure(energy_values.data(), Now(), energy_power.data());
+
+    for (size_t i = 0; i < names.size(); i++){
+        power[i] = values[i];
+    }
+    for (size_t i = 0; i < energy_devices.size(); i++){
+        power[energy_devices[i]] = energy_power[i];
+    }
+}
+
+bool mb::HwmonPowerSource::ReadEnergy(double* energy){
+    readValues();
+    counters.Update(energy_values.data());
+
+    fill(energy, energy + names.size(), NAN);
+    for (size_t i = 0; i < energy_devices.size(); i++){
+        energy[energy_devices[i]] = counters.Energy(i);
+    }
+    return energy_devices.size() > 0;
+}
+
+void mb::HwmonPowerSource::Reset(){
+    readValues();
+    counters.Reset(energy_values.data(), Now());
+}
+
+void mb::HwmonPowerSource::readValues(){
+    // One pread per sensor on the descriptors opened at construction
+    char buffer[32];
+    for (size_t i = 0; i < files.size(); i++){
+        ssize_t length = pread(files[i], buffer, sizeof(buffer) - 1, 0);
+        if (length <= 0){
+            // Drivers report e.g. ENODATA while the device is suspended, keep the last value
+            if (!warned[i]){
+                cout << "WARNING: Cannot read the hwmon sensor " << paths[i] << ", holding its last value!" << endl;
+                warned[i] = true;
+            }
+            continue;
+        }
+        buffer[length] = '\0';
+        values[i] = strtoull(buffer, nullptr, 10);
+    }
+    for (size_t i = 0; i < energy_devices.size(); i++){
+        energy_values[i] = values[energy_devices[i]];
+    }
+}
+
+void mb::HwmonPowerSource::addSensor(string path, string name, bool energy){
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0){
+        cout << "WARNING: Cannot open " << path << " (missing permissions?), skipping the sensor!" << endl;
+        return;
+    }
+    files.push_back(file);
+    paths.push_back(path);
+    if (energy) energy_devices.push_back(names.size());
+    names.push_back(name);
+}
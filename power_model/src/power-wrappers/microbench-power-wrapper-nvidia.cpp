@@ -1,17 +1,24 @@
-#include "microbench-power-wrapper.h"
+#include "microbench-power-source.h"
 #include <iostream>
+#include <memory>
 
 using namespace mb;
 using namespace std;
 
-mb::PowerWrapper::PowerWrapper(){
-    cout << "Power Wrapper for NVIDIA" << endl;
-}
+namespace mb{
+    // Placeholder until NVML is supported, delivers no devices
+    class NvidiaPowerSource : public PowerSource{
+        public:
+            NvidiaPowerSource(){
+                cout << "Power Wrapper for NVIDIA" << endl;
+            }
 
-void mb::PowerWrapper::Start(){
-    cout << "Start" << endl;
+            int DeviceCount(){ return 0; }
+            std::string DeviceName(int device){ return "device=" + to_string(device); }
+            void Measure(uint64_t*){}
+    };
 }
 
-void mb::PowerWrapper::Stop(){
-    cout << "End" << endl;
-}
\ No newline at end of file
+static PowerSourceRegistration registration("nvidia", [](string){
+    return (shared_ptr<PowerSource>)make_shared<NvidiaPowerSource>();
+});
\ No newline at end of file
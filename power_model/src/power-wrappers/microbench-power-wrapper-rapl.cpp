@@ -0,0 +1,125 @@
+#include "microbench-power-source-rapl.h"
+#include <iostream>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace mb;
+using namespace std;
+
+// Config: powercap root, default /sys/class/powercap
+static PowerSourceRegistration registration("rapl", [](string config){
+    if (config.empty()) return (shared_ptr<PowerSource>)make_shared<RaplPowerSource>();
+    return (shared_ptr<PowerSource>)make_shared<RaplPowerSource>(config);
+});
+
+mb::RaplPowerSource::RaplPowerSource(string root){
+    cout << "Power Wrapper for RAPL!" << endl;
+
+    if (!filesystem::is_directory(root)){
+        cout << "RAPL Error: The powercap directory " << root << " does not exist!" << endl;
+        exit(1);
+    }
+
+    // Find all zones that provide an energy counter, e.g. intel-rapl:0 and intel-rapl:0:2
+    vector<string> zones;
+    for (auto const& entry : filesystem::directory_iterator(root)){
+        string zone = entry.path().filename();
+        if (zone.rfind("intel-rapl:", 0) == 0 && filesystem::exists(entry.path() / "energy_uj")){
+            zones.push_back(zone);
+        }
+    }
+    sort(zones.begin(), zones.end());
+
+    if (zones.size() == 0){
+        cout << "RAPL Error: No powercap zones found in " << root << "!" << endl;
+        exit(1);
+    }
+
+    vector<uint64_t> max_energy;
+    for (string const& zone : zones){
+        string path = root + "/" + zone;
+
+        // Subzones (core, uncore, dram) are labeled with their package, e.g. package-0/dram
+        string name;
+        ifstream(path + "/name") >> name;
+        size_t separator = zone.find_last_of(':');
+        if (separator != zone.find(':')){
+            string package;
+            ifstream(root + "/" + zone.substr(0, separator) + "/name") >> package;
+            name = package + "/" + name;
+        }
+        names.push_back("rapl=" + name);
+
+        // Keep the counter open, every sample is a single pread
+        int file = open((path + "/energy_uj").c_str(), O_RDONLY);
+        if (file < 0){
+            cout << "RAPL Error: Cannot open " << path << "/energy_uj (missing permissions?)" << endl;
+            exit(1);
+        }
+        energy_files.push_back(file);
+        paths.push_back(path + "/energy_uj");
+
+        // Without a documented range (0) a smaller value is taken as a reset of the counter
+        int range_file = open((path + "/max_energy_range_uj").c_str(), O_RDONLY);
+        max_energy.push_back(range_file < 0 ? 0 : readValue(range_file, path + "/max_energy_range_uj"));
+        if (range_file >= 0) close(range_file);
+    }
+
+    raw_energy.assign(names.size(), 0);
+    readEnergy(raw_energy.data());
+    counters = EnergyCounters(max_energy);
+    counters.Reset(raw_energy.data(), Now());
+}
+
+mb::RaplPowerSource::~RaplPowerSource(){
+    for (int file : energy_files) close(file);
+}
+
+int mb::RaplPowerSource::DeviceCount(){
+    return names.size();
+}
+
+string mb::RaplPowerSource::DeviceName(int device){
+    return names[device];
+}
+
+void mb::RaplPowerSource::Measure(uint64_t* power){
+    readEnergy(raw_energy.data());
+    counters.Measure(raw_energy.data(), Now(), power);
+}
+
+bool mb::RaplPowerSource::ReadEnergy(double* energy){
+    readEnergy(raw_energy.data());
+    counters.Update(raw_energy.data());
+
+    for (size_t i = 0; i < names.size(); i++){
+        energy[i] = counters.Energy(i);
+    }
+    return true;
+}
+
+void mb::RaplPowerSource::Reset(){
+    readEnergy(raw_energy.data());
+    counters.Reset(raw_energy.data(), Now());
+}
+
+void mb::RaplPowerSource::readEnergy(uint64_t* energy){
+    for (size_t i = 0; i < energy_files.size(); i++){
+        energy[i] = readValue(energy_files[i], paths[i]);
+    }
+}
+
+uint64_t mb::RaplPowerSource::readValue(int file, string path){
+    char buffer[32];
+    ssize_t length = pread(file, buffer, sizeof(buffer) - 1, 0);
+    if (length <= 0){
+        cout << "RAPL Error: Cannot read " << path << "!" << endl;
+        exit(1);
+    }
+    buffer[length] = '\0';
+    return strtoull(buffer, nullptr, 10);
+}
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "microbench-power-source-replay.h"
+#include "microbench-power-trace.h"
+#include <iostream>
+#include <memory>
+#include <cstdlib>
+
+using namespace mb;
+using namespace std;
+
+// Config: "<trace>[,<speed>]" replays a power CSV or binary trace (default speed 0, virtual clock),
+// an empty config plays a synthetic idle/load profile on four devices
+static PowerSourceRegistration registration("replay", [](string config){
+    float speed = 0;
+    size_t separator = config.find_last_of(',');
+    if (separator != string::npos){
+        speed = atof(config.substr(separator + 1).c_str());
+        config = config.substr(0, separator);
+    }
+
+    if (!config.empty()){
+        return (shared_ptr<PowerSource>)make_shared<ReplayPowerSource>(config, speed);
+    }
+
+    SyntheticProfile profile(4, 2.0);
+    profile.Step(0.0, 90.0);
+    profile.Step(0.5, 400.0);
+    profile.Ramp(5.0, 450.0);
+    profile.Step(5.0, 90.0);
+    profile.Ramp(5.5, 90.0);
+    return (shared_ptr<PowerSource>)make_shared<SyntheticPowerSource>(profile, speed);
+});
+
+// Trace time base ==============================================================
+
+mb::TracePowerSource::TracePowerSource(float replay_speed){
+    speed = replay_speed;
+    start = monotonicNow();
+    virtual_now = 0;
+    end = 0;
+}
+
+void mb::TracePowerSource::Measure(uint64_t* power){
+    measureAt(traceTime(), power);
+}
+
+void mb::TracePowerSource::Reset(){
+    start = monotonicNow();
+    virtual_now = 0;
+}
+
+long mb::TracePowerSource::Now(){
+    return speed == 0 ? virtual_now : monotonicNow();
+}
+
+string mb::TracePowerSource::ClockName(){
+    return speed == 0 ? "virtual" : PowerSource::ClockName();
+}
+
+bool mb::TracePowerSource::SleepUntil(long deadline){
+    if (speed != 0){
+        return PowerSource::SleepUntil(deadline);
+    }
+
+    // Virtual clock: jump to the deadline, after the end of the trace only wait for Stop()
+    if (deadline <= end){
+        virtual_now = deadline;
+        return true;
+    }
+    virtual_now = end;
+    PowerSource::SleepUntil(monotonicNow() + 1000000);
+    return false;
+}
+
+bool mb::TracePowerSource::Pending(){
+    return speed == 0 && virtual_now < end;
+}
+
+long mb::TracePowerSource::traceTime(){
+    return speed == 0 ? virtual_now : (long)((monotonicNow() - start) * (double)speed);
+}
+
+long mb::TracePowerSource::monotonicNow(){
+    return PowerSource::Now();
+}
+
+// Replay =======================================================================
+
+mb::ReplayPowerSource::ReplayPowerSource(string path, float replay_speed) : TracePowerSource(replay_speed){
+    cout << "Power Wrapper for trace replay! (" << path << ")" << endl;
+
+    if (PowerTrace::IsTrace(path)){
+        PowerTrace trace(path);
+        for (int i = 0; i < trace.DeviceCount(); i++) names.push_back(trace.DeviceName(i));
+        timestamps.assign(trace.Timestamps(), trace.Timestamps() + trace.SampleCount());
+        power_values.resize(trace.SampleCount() * names.size());
+        for (size_t j = 0; j < trace.SampleCount(); j++){
+            for (size_t i = 0; i < names.size(); i++) power_values[j * names.size() + i] = trace.Power(i)[j];
+        }
+    } else {
+        PowerStore store = ReadPowerCsv(path, names);
+        for (size_t j = 0; j < store.Size(); j++){
+            timestamps.push_back(store.Timestamp(j));
+            for (size_t i = 0; i < names.size(); i++) power_values.push_back(store.Power(i, j));
+        }
+    }
+
+    if (timestamps.size() == 0){
+        cout << "Replay Error: The power trace " << path << " contains no samples!" << endl;
+        exit(1);
+    }
+
+    // Replay relative to the first sample
+    long first = timestamps.front();
+    for (long& timestamp : timestamps) timestamp -= first;
+    end = timestamps.back();
+    position = 0;
+}
+
+int mb::ReplayPowerSource::DeviceCount(){
+    return names.size();
+}
+
+string mb::ReplayPowerSource::DeviceName(int device){
+    return names[device];
+}
+
+void mb::ReplayPowerSource::Reset(){
+    TracePowerSource::Reset();
+    position = 0;
+}
+
+void mb::ReplayPowerSource::measureAt(long time, uint64_t* power){
+    // Hold the latest recorded sample at or before the requested time
+    while (position + 1 < timestamps.size() && timestamps[position + 1] <= time){
+        position++;
+    }
+    for (size_t i = 0; i < names.size(); i++){
+        power[i] = power_values[position * names.size() + i];
+    }
+}
+
+// Synthetic ====================================================================
+
+mb::SyntheticProfile::SyntheticProfile(int devices, double noise, unsigned seed){
+    Devices = devices;
+    Noise = noise;
+    Seed = seed;
+}
+
+void mb::SyntheticProfile::Step(double time, double watts){
+    if (Points.size() > 0){
+        Points.push_back({time, Points.back().second});
+    }
+    Points.push_back({time, watts});
+}
+
+void mb::SyntheticProfile::Ramp(double time, double watts){
+    Points.push_back({time, watts});
+}
+
+mb::SyntheticPowerSource::SyntheticPowerSource(SyntheticProfile synthetic_profile, float replay_speed) : TracePowerSource(replay_speed){
+    cout << "Power Wrapper for a synthetic profile!" << endl;
+
+    profile = synthetic_profile;
+    end = profile.Points.size() > 0 ? (long)(profile.Points.back().first * 1000000000) : 0;
+    noise = normal_distribution<double>(0.0, profile.Noise > 0 ? profile.Noise : 1.0);
+}
+
+int mb::SyntheticPowerSource::DeviceCount(){
+    return profile.Devices;
+}
+
+string mb::SyntheticPowerSource::DeviceName(int device){
+    return "device=" + to_string(device);
+}
+
+void mb::SyntheticPowerSource::Reset(){
+    TracePowerSource::Reset();
+
+    // Every run sees the same noise sequence
+    generator.seed(profile.Seed);
+    noise.reset();
+}
+
+void mb::SyntheticPowerSource::measureAt(long time, uint64_t* power){
+    double t = time / 1000000000.0;
+    vector<pair<double, double>>& points = profile.Points;
+
+    // Locate the segment, at a step the later point wins
+    double watts = 0.0;
+    if (points.size() > 0){
+        size_t i = 0;
+        while (i + 1 < points.size() && points[i + 1].first <= t) i++;
+
+        if (i + 1 < points.size() && t >= points[i].first){
+            double fraction = (t - points[i].first) / (points[i + 1].first - points[i].first);
+            watts = points[i].second + fraction * (points[i + 1].second - points[i].second);
+        } else {
+            watts = points[i].second;
+        }
+    }
+
+    for (int d = 0; d < profile.Devices; d++){
+        double value = watts + (profile.Noise > 0 ? noise(generator) : 0.0);
+        power[d] = value > 0 ? (uint64_t)(value * 1000000) : 0;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,520 @@
+#include "microbench-power-wrapper.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <time.h>
+
+using namespace mb;
+using namespace std;
+
+mb::PowerWrapper::PowerWrapper(){
+    sources_registered = false;
+    measurement_duration = 0.0;
+    energy_mode = EnergyMode::SAMPLES;
+    energy_counters = 0;
+
+    loop_cancel = false;
+    loop_interval = 0;
+    loop_tick = 0;
+    loop_start = 0;
+    loop_retention = TraceRetention::FULL;
+    loop_decimation = 1;
+    loop_capacity_duration = 60;
+    loop_capacity_policy = OverflowPolicy::DISCARD_NEWEST;
+    loop_capacity_fixed = false;
+    loop_jitter_sum = 0;
+    loop_jitter_max = 0;
+    loop_jitter_count = 0;
+    loop_missed = 0;
+    loop_last_timestamp = 0;
+    loop_last_tick = 0;
+
+    counter_divisor = 1;
+    counter_next_tick = 0;
+
+    adaptive_max_interval = 0;
+    adaptive_threshold = 5.0;
+    adaptive_transition = false;
+    configureSources();
+}
+
+mb::PowerWrapper::PowerWrapper(int interval) : PowerWrapper(){
+    loop_interval = interval;
+
+    // Open the registered sources right away, so the device count and the CSV header
+    // are known before the first run
+    for (string const& name : PowerSourceRegistry::Names()){
+        addSource(PowerSourceRegistry::Create(name), name, 0);
+    }
+    sources_registered = sources.size() > 0;
+    configureSources();
+}
+
+mb::PowerWrapper::PowerWrapper(int interval, shared_ptr<PowerSource> source) : PowerWrapper(){
+    loop_interval = interval;
+    AddSource(source);
+}
+
+void mb::PowerWrapper::AddSource(string name, string config, int interval){
+    addSource(PowerSourceRegistry::Create(name, config), name, interval);
+}
+
+void mb::PowerWrapper::AddSource(shared_ptr<PowerSource> source, int interval){
+    addSource(source, "source=" + to_string(sources_registered ? 0 : sources.size()), interval);
+}
+
+void mb::PowerWrapper::Start(){
+    if (sources.size() == 0){
+        cout << "ERROR: There is no power source available!" << endl;
+        exit(1);
+    }
+
+    loop_cancel = false;            
+    loop_store.Clear();
+    markers.clear();
+    loop_statistics.Clear();
+    loop_jitter_sum = 0;
+    loop_jitter_max = 0;
+    loop_jitter_count = 0;
+    loop_missed = 0;
+    loop_gap.Clear();
+    for (auto& histogram : loop_read_latency) histogram.Clear();
+    
+    for (auto const& source : sources){
+        source->Reset();
+    }
+    // Counter columns are fixed for the run
+    counter_names.clear();
+    if (counter_source){
+        for (int i = 0; i < counter_source->CounterCount(); i++) counter_names.push_back(counter_source->CounterName(i));
+    }
+    counter_values.assign(counter_names.size(), 0);
+    counter_next_tick = 0;
+    if (counter_store.DeviceCount() != (int)counter_names.size()) configureCapacity();
+    counter_store.Clear();
+
+    loop_tick = 0;
+    loop_last_tick = 0;
+    adaptive_transition = false;
+    loop_start = addMeasurement(true);
+    adaptive_previous = power_measurement;
+    if (energy_mode == EnergyMode::COUNTER) readEnergy(energy_start);
+    if (loop_tick_interval > 0) loop_thread = thread(&PowerWrapper::loop, this);
+}
+
+void mb::PowerWrapper::Stop(){
+    loop_cancel = true;
+    if (loop_thread.joinable()) loop_thread.join();
+
+    addMeasurement(true);
+    if (energy_mode == EnergyMode::COUNTER) readEnergy(energy_stop);
+    calculateDuration();
+    calculateEnergy();
+}
+
+long mb::PowerWrapper::Now(){
+    return now();
+}
+
+void mb::PowerWrapper::AddMarker(long timestamp, std::string label){
+    markers.push_back(PowerMarker(timestamp, label));
+}
+
+void mb::PowerWrapper::MarkTransition(){
+    adaptive_transition = true;
+}
+
+void mb::PowerWrapper::Print(){
+    cout << "POWER COUNTERS: Measured for " << measurement_duration << " s and collected " << loop_statistics.Count() << " samples!" << endl;
+    if (adaptive_max_interval > 0){
+        cout << "\tADAPTIVE: " << loop_statistics.Count() << " samples for " << loop_tick << " ticks (interval " << loop_tick_interval
+            << " to " << adaptive_max_stride * loop_tick_interval << " us, threshold " << adaptive_threshold << " W)" << endl;
+    }
+    cout << "\tJITTER: mean " << getJitterMean() << " us, max " << loop_jitter_max / 1000.0 << " us, missed " << loop_missed << " deadlines (interval " << loop_tick_interval << " us)" << endl;
+    cout << "\tGAP: p50 " << loop_gap.Percentile(50) / 1000.0 << " us, p99 " << loop_gap.Percentile(99) / 1000.0 << " us, max " << loop_gap.Max() / 1000.0 << " us" << endl;
+    for (size_t s = 0; s < sources.size(); s++){
+        LatencyHistogram& latency = loop_read_latency[s];
+        cout << "\tREAD:" << source_names[s] << ": p50 " << latency.Percentile(50) / 1000.0 << " us, p99 " << latency.Percentile(99) / 1000.0 << " us, max " << latency.Max() / 1000.0 << " us" << endl;
+    }
+    if (loop_retention != TraceRetention::FULL){
+        cout << "\tTRACE: kept " << loop_store.Size() << " samples" << endl;
+    }
+    if (counter_source){
+        cout << "\tCOUNTERS: " << counter_store.Size() << " reads of " << counter_names.size() << " counters (every " << counter_divisor << " ticks)" << endl;
+    }
+    if (loop_store.Dropped() > 0){
+        cout << "\tWARNING: " << loop_store.Dropped() << " samples exceeded the capacity of " << loop_store.Capacity() << " samples!" << endl;
+    }
+    if (energy_mode == EnergyMode::COUNTER){
+        cout << "\tCOUNTERS: " << energy_counters << " of " << device_count << " devices measured by hardware energy counters" << endl;
+    }
+    for (int i = 0; i < device_count; i++){
+        double energy_per_second = energy_measurement[i] / measurement_duration;
+
+        std::cout << "\tENERGY:" << device_names[i] << ": " << energy_measurement[i] << " J => " << energy_per_second << " J/s"
+            << " (power mean " << loop_statistics.Mean(i) << " W, std " << loop_statistics.Std(i)
+            << " W, min " << loop_statistics.Min(i) << " W, max " << loop_statistics.Max(i) << " W)" << std::endl;
+    }
+}
+
+string mb::PowerWrapper::GetCsvHeader(){
+    string line_str = "duration,samples,jitter_mean,jitter_max,missed,energy_counters,gap_p50,gap_p99,gap_max,";
+    for (string const& name : source_names){
+        line_str += "READ_P50:" + name + "," + "READ_P99:" + name + "," + "READ_MAX:" + name + ",";
+    }
+    
+    for (int i = 0; i < device_count; i++){
+        line_str += "ENERGY:" + device_names[i] + "," + "ENERGY_PER_SECOND:" + device_names[i] + ","
+            + "POWER_MEAN:" + device_names[i] + "," + "POWER_STD:" + device_names[i] + ","
+            + "POWER_MIN:" + device_names[i] + "," + "POWER_MAX:" + device_names[i] + ",";
+    }
+
+    return line_str;
+}
+
+string mb::PowerWrapper::GetCsvLine(){           
+    string line_str = to_string(measurement_duration) + "," + to_string(loop_statistics.Count()) + ","
+        + to_string(getJitterMean()) + "," + to_string(loop_jitter_max / 1000.0) + "," + to_string(loop_missed) + ","
+        + to_string(energy_counters) + ","
+        + to_string(loop_gap.Percentile(50) / 1000.0) + "," + to_string(loop_gap.Percentile(99) / 1000.0) + "," + to_string(loop_gap.Max() / 1000.0) + ",";
+    for (LatencyHistogram& latency : loop_read_latency){
+        line_str += to_string(latency.Percentile(50) / 1000.0) + "," + to_string(latency.Percentile(99) / 1000.0) + "," + to_string(latency.Max() / 1000.0) + ",";
+    }
+    
+    for (int i = 0; i < device_count; i++){
+        double energy_per_second = energy_measurement[i] / measurement_duration;
+        line_str += to_string(energy_measurement[i]) + "," + to_string(energy_per_second) + ","
+            + to_string(loop_statistics.Mean(i)) + "," + to_string(loop_statistics.Std(i)) + ","
+            + to_string(loop_statistics.Min(i)) + "," + to_string(loop_statistics.Max(i)) + ",";
+    }
+
+    return line_str;
+}
+
+void mb::PowerWrapper::WritePowerCsv(std::string path){
+    loop_store.WriteCsv(path, device_names, markers);
+}
+
+void mb::PowerWrapper::WritePowerTrace(std::string path){
+    PowerTrace::Write(path, loop_store, device_names, sources.size() > 0 ? sources[0]->ClockName() : "CLOCK_MONOTONIC", markers);
+}
+
+void mb::PowerWrapper::WriteCounterCsv(std::string path){
+    string buffer = "id,timestamp,";
+    for (string const& name : counter_names) buffer += name + ",";
+    buffer.back() = '\n';
+
+    // Increments since the previous read, the first read counts from the start of the run
+    for (size_t j = 0; j < counter_store.Size(); j++){
+        buffer += to_string(j) + "," + to_string(counter_store.Timestamp(j));
+        for (size_t i = 0; i < counter_names.size(); i++){
+            uint64_t previous = j > 0 ? counter_store.Power(i, j - 1) : 0;
+            buffer += "," + to_string(counter_store.Power(i, j) - previous);
+        }
+        buffer += "\n";
+    }
+
+    ofstream csv_file(path, ios_base::out | ios_base::binary);
+    csv_file.write(buffer.data(), buffer.size());
+}
+
+void mb::PowerWrapper::WriteLatencyCsv(std::string path){
+    // Non-empty buckets of all histograms in us
+    string buffer = "histogram,lower,upper,count\n";
+    auto append = [&](string name, LatencyHistogram& histogram){
+        for (size_t i = 0; i < histogram.BucketCount(); i++){
+            if (histogram.BucketValue(i) == 0) continue;
+            buffer += name + "," + to_string(histogram.BucketLower(i) / 1000.0) + "," + to_string(histogram.BucketUpper(i) / 1000.0) + ","
+                + to_string(histogram.BucketValue(i)) + "\n";
+        }
+    };
+    append("gap", loop_gap);
+    for (size_t s = 0; s < sources.size(); s++){
+        append("read:" + source_names[s], loop_read_latency[s]);
+    }
+
+    ofstream csv_file(path, ios_base::out | ios_base::binary);
+    csv_file.write(buffer.data(), buffer.size());
+}
+
+void mb::PowerWrapper::ConfigureCapacity(float expected_duration, OverflowPolicy policy){
+    loop_capacity_duration = expected_duration;
+    loop_capacity_policy = policy;
+    loop_capacity_fixed = true;
+    configureCapacity();
+}
+
+void mb::PowerWrapper::ConfigureInterval(int interval){
+    loop_interval = interval;
+    configureSources();
+}
+
+void mb::PowerWrapper::ConfigureEnergyMode(EnergyMode mode){
+    energy_mode = mode;
+}
+
+void mb::PowerWrapper::ConfigureRetention(TraceRetention retention, int decimation){
+    loop_retention = retention;
+    loop_decimation = retention == TraceRetention::DECIMATED && decimation > 1 ? decimation : 1;
+    configureCapacity();
+}
+
+void mb::PowerWrapper::ConfigureSamplerThread(ThreadPlacement placement){
+    loop_placement = placement;
+}
+
+void mb::PowerWrapper::ConfigureCounters(shared_ptr<CounterSource> source, int divisor){
+    counter_source = source;
+    counter_divisor = divisor > 0 ? divisor : 1;
+}
+
+void mb::PowerWrapper::ConfigureAdaptive(int max_interval, double threshold){
+    adaptive_max_interval = max_interval;
+    adaptive_threshold = threshold;
+    configureSources();
+}
+
+int mb::PowerWrapper::GetInterval(){
+    return loop_interval;
+}
+
+EnergyMode mb::PowerWrapper::GetEnergyMode(){
+    return energy_mode;
+}
+
+int mb::PowerWrapper::GetDeviceCount(){
+    return device_count;
+}
+
+int mb::PowerWrapper::GetEnergyCounters(){
+    return energy_counters;
+}
+
+bool mb::PowerWrapper::IsEnergyCounted(int device){
+    return energy_mode == EnergyMode::COUNTER && isfinite(energy_start[device]) && isfinite(energy_stop[device]);
+}
+
+double mb::PowerWrapper::GetDuration(){
+    return measurement_duration;
+}
+
+double mb::PowerWrapper::GetEnergy(int device){
+    return energy_measurement[device];
+}
+
+double mb::PowerWrapper::GetEnergy(int device, long from, long to){
+    return loop_store.Energy(device, from, to);
+}
+
+string mb::PowerWrapper::GetDeviceName(int device){
+    return device_names[device];
+}
+
+void mb::PowerWrapper::addSource(shared_ptr<PowerSource> source, string name, int interval){
+    // Explicit sources replace the registered ones opened by the constructor
+    if (sources_registered){
+        sources.clear();
+        source_names.clear();
+        source_intervals.clear();
+        loop_read_latency.clear();
+        sources_registered = false;
+    }
+    sources.push_back(source);
+    source_names.push_back(name);
+    source_intervals.push_back(interval);
+    loop_read_latency.push_back(LatencyHistogram());
+    configureSources();
+}
+
+void mb::PowerWrapper::configureSources(){
+    // Tick at the smallest requested interval
+    loop_tick_interval = loop_interval;
+    for (int interval : source_intervals){
+        if (interval > 0 && interval < loop_tick_interval) loop_tick_interval = interval;
+    }
+    if (loop_tick_interval > 0 && loop_tick_interval < 100){
+        cout << "WARNING: Power sampling intervals below 100 us are not supported, using 100 us!" << endl;
+        loop_tick_interval = 100;
+    }
+
+    // Assign every source its columns and its tick divisor
+    device_count = 0;
+    device_names.clear();
+    source_divisors.clear();
+    source_offsets.clear();
+    for (size_t s = 0; s < sources.size(); s++){
+        int interval = source_intervals[s] > 0 ? source_intervals[s] : loop_interval;
+        int divisor = loop_tick_interval > 0 ? (interval + loop_tick_interval / 2) / loop_tick_interval : 1;
+        source_divisors.push_back(divisor > 0 ? divisor : 1);
+        source_offsets.push_back(device_count);
+
+        for (int i = 0; i < sources[s]->DeviceCount(); i++){
+            device_names.push_back(sources[s]->DeviceName(i));
+        }
+        device_count += sources[s]->DeviceCount();
+    }
+
+    source_next_tick.assign(sources.size(), 0);
+    adaptive_max_stride = 1;
+    if (adaptive_max_interval > loop_tick_interval && loop_tick_interval > 0){
+        adaptive_max_stride = adaptive_max_interval / loop_tick_interval;
+    }
+
+    power_measurement.assign(device_count, 0);
+    adaptive_previous.assign(device_count, 0);
+    energy_measurement.assign(device_count, 0.0);
+    energy_start.assign(device_count, NAN);
+    energy_stop.assign(device_count, NAN);
+    loop_statistics = PowerStatistics(device_count);
+
+    // Keep the capacity matching the expected duration
+    configureCapacity();
+}
+
+void mb::PowerWrapper::configureCapacity(){
+    // One sample per tick (or per n-th tick) plus 10 % headroom for the samples at start and stop
+    size_t capacity = 0;
+    if (loop_retention != TraceRetention::OFF){
+        capacity = 2;
+        if (loop_tick_interval > 0) capacity += (size_t)(loop_capacity_duration * 1000000 / loop_tick_interval / loop_decimation * 1.1);
+    }
+    loop_store = PowerStore(device_count, capacity, loop_capacity_policy, loop_capacity_fixed ? 0 : capacity);
+
+    // Counters are kept completely, one read per divisor ticks
+    size_t counter_capacity = 0;
+    if (counter_source){
+        counter_capacity = 2;
+        if (loop_tick_interval > 0) counter_capacity += (size_t)(loop_capacity_duration * 1000000 / loop_tick_interval / counter_divisor * 1.1);
+    }
+    counter_store = PowerStore(counter_names.size(), counter_capacity, loop_capacity_policy, loop_capacity_fixed ? 0 : counter_capacity);
+}
+
+void mb::PowerWrapper::loop(){
+    long interval = (long)loop_tick_interval * 1000;
+    long deadline = loop_start + interval;
+    long previous = loop_start;
+    long stride = 1;
+    long gap = 1;
+    loop_placement.Apply("power sampler");
+
+    while (!loop_cancel || sources[0]->Pending()){
+        // Sleep until the absolute deadline
+        if (!sources[0]->SleepUntil(deadline)) continue;
+
+        long timestamp = addMeasurement();
+
+        // Deviation of the actual sample gap from the nominal one, the gap spans the
+        // stride and the ticks skipped after missed deadlines
+        long deviation = labs(timestamp - previous - gap * interval);
+        loop_jitter_sum += deviation;
+        loop_jitter_max = deviation > loop_jitter_max ? deviation : loop_jitter_max;
+        loop_jitter_count++;
+        previous = timestamp;
+
+        // Skip the ticks of the next period and the deadlines that already passed while reading
+        stride = adaptStride(stride);
+        gap = stride;
+        deadline += stride * interval;
+        loop_tick += stride - 1;
+        long current = now();
+        if (current >= deadline){
+            long missed = (current - deadline) / interval + 1;
+            loop_missed += missed;
+            loop_tick += missed;
+            deadline += missed * interval;
+            gap += missed;
+        }
+    }
+}
+
+long mb::PowerWrapper::now(){
+    return sources[0]->Now();
+}
+
+long mb::PowerWrapper::monotonicNow(){
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+double mb::PowerWrapper::getJitterMean(){
+    return loop_jitter_count > 0 ? loop_jitter_sum / loop_jitter_count / 1000.0 : 0.0;
+}
+
+long mb::PowerWrapper::adaptStride(long stride){
+    if (adaptive_max_stride <= 1) return 1;
+
+    // Any device moving by more than the threshold since the last sample counts as a transition
+    bool transition = adaptive_transition.exchange(false);
+    for (int i = 0; i < device_count; i++){
+        double change = fabs((double)power_measurement[i] - (double)adaptive_previous[i]) / 1000000;
+        if (change > adaptive_threshold) transition = true;
+        adaptive_previous[i] = power_measurement[i];
+    }
+
+    if (transition) return 1;
+    return stride * 2 < adaptive_max_stride ? stride * 2 : adaptive_max_stride;
+}
+
+long mb::PowerWrapper::addMeasurement(bool all){
+    // Read the sources due on this tick, the others keep their previous values
+    for (size_t s = 0; s < sources.size(); s++){
+        if (all || loop_tick >= source_next_tick[s]){
+            long read_start = monotonicNow();
+            sources[s]->Measure(power_measurement.data() + source_offsets[s]);
+            loop_read_latency[s].Record(monotonicNow() - read_start);
+            source_next_tick[s] = loop_tick + source_divisors[s];
+        }
+    }
+    bool read_counters = counter_source && (all || loop_tick >= counter_next_tick);
+    if (read_counters){
+        counter_source->Read(counter_values.data());
+        counter_next_tick = loop_tick + counter_divisor;
+    }
+
+    // Every sample stands for the ticks since the previous one
+    double weight = loop_tick > loop_last_tick ? loop_tick - loop_last_tick : 1;
+    loop_last_tick = loop_tick;
+    loop_tick++;
+    long timestamp = now();
+
+    if (loop_statistics.Count() > 0) loop_gap.Record(timestamp - loop_last_timestamp);
+    loop_last_timestamp = timestamp;
+
+    // Fold into the statistics, keep the raw sample only as far as requested
+    loop_statistics.Add(timestamp, power_measurement.data(), weight);
+    bool keep = loop_retention == TraceRetention::FULL
+        || (loop_retention == TraceRetention::DECIMATED && (all || (loop_statistics.Count() - 1) % loop_decimation == 0));
+    if (keep) loop_store.Append(timestamp, power_measurement.data());
+    if (read_counters) counter_store.Append(timestamp, counter_values.data());
+    return timestamp;
+}
+
+void mb::PowerWrapper::calculateDuration(){
+    measurement_duration = loop_statistics.Duration();
+}
+
+void mb::PowerWrapper::calculateEnergy(){
+    energy_counters = 0;
+    for (int i = 0; i < device_count; i++){
+        // Hardware accumulators where available, running trapezoid of all samples otherwise
+        if (IsEnergyCounted(i)){
+            energy_measurement[i] = energy_stop[i] - energy_start[i];
+            energy_counters++;
+        } else {
+            energy_measurement[i] = loop_statistics.Energy(i);
+        }
+    }
+}
+
+void mb::PowerWrapper::readEnergy(vector<double>& energy){
+    for (size_t s = 0; s < sources.size(); s++){
+        double* values = energy.data() + source_offsets[s];
+        if (!sources[s]->ReadEnergy(values)){
+            fill(values, values + sources[s]->DeviceCount(), NAN);
+        }
+    }
+}
\ No newline at end of file
@@ -2,41 +2,189 @@
 
 #include <iostream>
 #include <list>
+#include <atomic>
 #include <thread>
+#include <memory>
+#include <vector>
+
+#include "microbench-power-store.h"
+#include "microbench-power-statistics.h"
+#include "microbench-power-trace.h"
+#include "microbench-power-thread.h"
+#include "microbench-power-histogram.h"
+#include "microbench-power-source.h"
 
 namespace mb{
+    enum EnergyMode {
+        SAMPLES,    // Integrate the power samples (trapezoid)
+        COUNTER     // Difference of the hardware energy accumulators at Start and Stop,
+                    // devices without an accumulator fall back to the samples
+    };
+
+    // How much of the raw power trace is kept for WritePowerCsv/WritePowerTrace, the statistics
+    // in the CSV line always cover every sample
+    enum TraceRetention {
+        OFF,        // No trace, memory stays constant regardless of the run length
+        DECIMATED,  // Every n-th sample plus the samples at start and stop
+        FULL        // Every sample
+    };
+
     class PowerWrapper{
         public:
             PowerWrapper();
             PowerWrapper(int interval);
+            PowerWrapper(int interval, std::shared_ptr<PowerSource> source);
+
+            // Sources are sampled into one trace with a shared timestamp column. An
+            // interval of 0 uses the interval of the wrapper. PowerWrapper(interval)
+            // opens all sources registered in the binary, the first added source
+            // replaces them.
+            void AddSource(std::string name, std::string config = "", int interval = 0);
+            void AddSource(std::shared_ptr<PowerSource> source, int interval = 0);
 
             void Start();
             void Stop();
             void Print();
 
+            // Clock of the sampler in ns, markers and windows use this time base
+            long Now();
+            void AddMarker(long timestamp, std::string label);
+
             std::string GetCsvHeader();
             std::string GetCsvLine();
             void WritePowerCsv(std::string path);
+            void WritePowerTrace(std::string path);
+            void WriteLatencyCsv(std::string path);
+            // Preallocate the trace for runs up to expected_duration s, later samples are handled
+            // by the policy. Without this call the trace starts at one minute and grows by a
+            // minute whenever it is full.
+            void ConfigureCapacity(float expected_duration, OverflowPolicy policy = OverflowPolicy::DISCARD_NEWEST);
+            void ConfigureInterval(int interval);
+            void ConfigureEnergyMode(EnergyMode mode);
+            void ConfigureRetention(TraceRetention retention, int decimation = 10);
+            void ConfigureSamplerThread(ThreadPlacement placement);
+
+            // Adaptive sampling: the sampler doubles its period (up to max_interval in us)
+            // while the power is steady and falls back to the base interval as soon as a
+            // device changes by more than threshold W between two samples or a transition
+            // is marked. A max_interval of 0 samples every tick.
+            void ConfigureAdaptive(int max_interval, double threshold = 5.0);
+
+            // Read the counters on every n-th sampler tick (and at Start and Stop) into a
+            // second trace with the timestamps of the power samples. Reads happen on the
+            // sampler thread while it runs. A null source disables counter sampling.
+            void ConfigureCounters(std::shared_ptr<CounterSource> source, int divisor = 1);
+
+            // Counter increments between consecutive reads, one line per read
+            void WriteCounterCsv(std::string path);
+
+            // Hint of an upcoming power transition (e.g. a kernel launch), the next
+            // samples are taken at the base interval again
+            void MarkTransition();
+
+            int GetInterval();
+            EnergyMode GetEnergyMode();
+            int GetDeviceCount();
+            int GetEnergyCounters();
+
+            // True if the energy of the device in the last run is the difference of its
+            // hardware accumulator (EnergyMode::COUNTER), false if it is integrated from samples
+            bool IsEnergyCounted(int device);
+            double GetDuration();
+            double GetEnergy(int device);
+            std::string GetDeviceName(int device);
+
+            // Energy within a window of the sampler clock from the retained trace,
+            // NaN if the trace does not cover the window (e.g. TraceRetention::OFF)
+            double GetEnergy(int device, long from, long to);
 
         private:
+            std::vector<std::shared_ptr<PowerSource>> sources;
+            std::vector<int> source_intervals;
+            std::vector<int> source_divisors;
+            std::vector<long> source_next_tick;
+            std::vector<int> source_offsets;
+            std::vector<std::string> source_names;
+            bool sources_registered;
+
             int device_count;            
-            float measurement_duration;
-            uint64_t* power_measurement;
-            float* energy_measurement;
+            std::vector<std::string> device_names;
+            std::vector<PowerMarker> markers;
+            double measurement_duration;
+            std::vector<uint64_t> power_measurement;
+            std::vector<double> energy_measurement;
+
+            EnergyMode energy_mode;
+            std::vector<double> energy_start;
+            std::vector<double> energy_stop;
+            int energy_counters;
             
             std::thread loop_thread;
-            bool loop_cancel;
+            ThreadPlacement loop_placement;
+            std::atomic<bool> loop_cancel;
             int loop_interval;        
-            std::list<uint64_t> *loop_power_values;
-            std::list<long> loop_timestamp_values;
+            int loop_tick_interval;
+            long loop_tick;
+            long loop_start;
+            PowerStore loop_store;
+            PowerStatistics loop_statistics;
+            TraceRetention loop_retention;
+            int loop_decimation;
+            float loop_capacity_duration;
+            OverflowPolicy loop_capacity_policy;
+            bool loop_capacity_fixed;
+
+            // Sampling jitter of the last run in ns
+            double loop_jitter_sum;
+            long loop_jitter_max;
+            size_t loop_jitter_count;
+            size_t loop_missed;
+
+            // Duration of every Measure() call per source and the actual gap
+            // between consecutive samples in ns, stalls show up in the tails
+            std::vector<LatencyHistogram> loop_read_latency;
+            LatencyHistogram loop_gap;
+            long loop_last_timestamp;
+            long loop_last_tick;
+
+            // Counter time series
+            std::shared_ptr<CounterSource> counter_source;
+            int counter_divisor;
+            long counter_next_tick;
+            std::vector<uint64_t> counter_values;
+            std::vector<std::string> counter_names;
+            PowerStore counter_store;
+
+            // Adaptive sampling, the stride is the current period in ticks
+            int adaptive_max_interval;
+            double adaptive_threshold;
+            long adaptive_max_stride;
+            std::atomic<bool> adaptive_transition;
+            std::vector<uint64_t> adaptive_previous;
 
-            void measurePower();
-            void addMeasurement();
-            void handleReturn(int retval);
+            void addSource(std::shared_ptr<PowerSource> source, std::string name, int interval);
+            void configureSources();
+            void configureCapacity();
+            void readEnergy(std::vector<double>& energy);
+            long addMeasurement(bool all = false);
             void calculateDuration();
             void calculateEnergy();
 
+            // An interval of 0 disables the sampler thread, only Start and Stop are sampled.
+            // The sampler thread wakes up on absolute deadlines (start + k * interval)
+            // of the monotonic clock, so read latency never shifts later samples.
+            // It ticks at the smallest source interval; each source is read on every
+            // n-th tick and holds its last value in between. The clock hooks of the
+            // first source drive the loop.
+            // Catch-up policy: if a read overruns one or more deadlines, the missed
+            // ticks are skipped and counted instead of being sampled in a burst;
+            // sampling resumes on the next deadline still in the future.
+            // In adaptive mode the deadlines stay on the tick grid, the loop only skips
+            // a growing number of ticks between samples.
             void loop();
-            int loopCallback();
+            long now();
+            long monotonicNow();
+            double getJitterMean();
+            long adaptStride(long stride);
     };
 }
\ No newline at end of file
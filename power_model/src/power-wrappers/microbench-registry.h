@@ -0,0 +1,55 @@
+#pragma once
+
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <functional>
+
+namespace mb{
+    // Maps backend names to factories of T taking one Arg (e.g. a config string).
+    // Every backend file linked into the binary registers itself with a static
+    // Registration, so the available backends are chosen at link time.
+    template <typename T, typename Arg>
+    class Registry{
+        public:
+            typedef std::function<std::shared_ptr<T>(Arg)> Factory;
+
+            class Registration{
+                public:
+                    Registration(std::string name, Factory factory){
+                        Register(name, factory);
+                    }
+            };
+
+            static void Register(std::string name, Factory factory){
+                factories()[name] = factory;
+            }
+
+            static bool Contains(std::string name){
+                return factories().count(name) > 0;
+            }
+
+            // Null if no backend of that name is linked into the binary
+            static std::shared_ptr<T> Create(std::string name, Arg arg){
+                auto factory = factories().find(name);
+                if (factory == factories().end()) return nullptr;
+                return factory->second(arg);
+            }
+
+            static std::list<std::string> Names(){
+                std::list<std::string> names;
+                for (auto const& pair : factories()){
+                    names.push_back(pair.first);
+                }
+                return names;
+            }
+
+        private:
+            static std::map<std::string, Factory>& factories(){
+                // Function-local so registrations from other translation units never see it uninitialized
+                static std::map<std::string, Factory> registry;
+                return registry;
+            }
+    };
+}
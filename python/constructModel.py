@@ -12,32 +12,44 @@ def handleRun(path):
     counter_path = os.path.join(path, "counter.csv")
     df_counter = pd.read_csv(counter_path)
 
-    power_paths = [os.path.join(path, fn) for fn in os.listdir(path) if "power" in fn]
-    dfs_power = {}    
     devices = [":device=" + str(i) for i in range(DEVICE_COUNT)]
 
-    for file in power_paths:
-        df = pd.read_csv(file)
-        df["timestamp"] = (df["timestamp"] - df["timestamp"][0]) / 1000000000
-        for device in devices:
-            df["power" + device] = df["power" + device] / 1000000
-        dfs_power[file] = df
-
     benchmark = df_counter["benchmark"][0]
     arr = df_counter["arr"][0]
     n = df_counter["n"][0]    
-    duration = np.mean(df_counter["duration"])
+    # Lanes per work-item, older measurements are scalar
+    vec = df_counter["vec"][0] if "vec" in df_counter.columns else 1
+    # Launch configuration, 0 for the runtime default
+    work_group = df_counter["work_group"][0] if "work_group" in df_counter.columns else 0
+    local_memory = df_counter["local_memory"][0] if "local_memory" in df_counter.columns else 0
+    active_units = df_counter["active_units"][0] if "active_units" in df_counter.columns else 0
+    # Kernel window from the SYCL profiling events, older measurements only have the whole run
+    kernel_window = "kernel_duration" in df_counter.columns
+    duration = np.mean(df_counter["kernel_duration" if kernel_window else "duration"])
     sq_insts = np.mean(df_counter[f"rocm:::SQ_INSTS:device={DEVICE_ID}"])
     sq_insts_valu = np.mean(df_counter[f"rocm:::SQ_INSTS_VALU:device={DEVICE_ID}"])
     sq_insts_mfma = np.mean(df_counter[f"rocm:::SQ_INSTS_MFMA:device={DEVICE_ID}"])
     sq_insts_salu = np.mean(df_counter[f"rocm:::SQ_INSTS_SALU:device={DEVICE_ID}"])
 
     # Multi Val
-    energy = [np.average(df_counter["ENERGY" + device]) for device in devices]    
-    standard_deviations = [np.average([np.std(df["power" + device]) for df in dfs_power.values()]) for device in devices]
+    energy = [np.average(df_counter[("KERNEL_ENERGY" if kernel_window else "ENERGY") + device]) for device in devices]    
+    # Power spread of the samples, older measurements do not have it
+    standard_deviations = [np.average(df_counter["POWER_STD" + device]) if "POWER_STD" + device in df_counter.columns else np.nan for device in devices]
 
     # Add to results
-    return [benchmark, arr, n, duration] + energy + standard_deviations + [sq_insts, sq_insts_valu, sq_insts_mfma, sq_insts_salu]
+    return [benchmark, arr, n, vec, work_group, local_memory, active_units, duration] + energy + standard_deviations + [sq_insts, sq_insts_valu, sq_insts_mfma, sq_insts_salu]
+
+def fitOccupancy(df):
+    # Device power over the busy compute units: static power (intercept) and dynamic power per unit (slope)
+    df_occupancy = df[(df["benchmark"] == "Occupancy") & (df["active_units"] > 0)]
+    for vec, df_vec in df_occupancy.groupby("vec"):
+        if df_vec["active_units"].nunique() < 2:
+            continue
+        units = df_vec["active_units"].astype(float)
+        for i in range(DEVICE_COUNT):
+            power = (df_vec[f"e_d{i}"] / df_vec["duration"]).astype(float)
+            dynamic, static = np.polyfit(units, power, 1)
+            print(f"Occupancy (vec {vec}) device {i}: static {static:.1f} W, dynamic {dynamic:.3f} W per active compute unit")
 
 def handleBenchmark(path):
     benchmarks = [os.path.join(path, dir) for dir in os.listdir(path)]
@@ -48,7 +60,7 @@ if __name__ == "__main__":
     model_name = "model"
     model_path = os.path.join(BASE_PATH, model_name)
 
-    df_result_cols = ["benchmark", "arr", "n", "duration", "e_d0", "e_d1", "e_d2","e_d3", "p_std_d0", "p_std_d1", "p_std_d2", "p_std_d3", "sq_insts", "sq_insts_valu", "sq_insts_mfma", "sq_insts_salu"]
+    df_result_cols = ["benchmark", "arr", "n", "vec", "work_group", "local_memory", "active_units", "duration", "e_d0", "e_d1", "e_d2","e_d3", "p_std_d0", "p_std_d1", "p_std_d2", "p_std_d3", "sq_insts", "sq_insts_valu", "sq_insts_mfma", "sq_insts_salu"]
     df_result = pd.DataFrame(columns=df_result_cols)
 
     dirs = [os.path.join(model_path, dir) for dir in os.listdir(model_path)]    
@@ -56,9 +68,10 @@ if __name__ == "__main__":
         df_new = pd.DataFrame(handleBenchmark(dir), columns=df_result_cols)
         df_result = pd.concat([df_result, df_new], ignore_index=True)
 
-    df_result = df_result.sort_values(by=["benchmark", "arr"]).reset_index(drop=True)
+    df_result = df_result.sort_values(by=["benchmark", "vec", "work_group", "local_memory", "active_units", "arr"]).reset_index(drop=True)
 
     ts = str(datetime.datetime.now()).split(".")[0].replace(":", "-").replace(" ", "_")
     result_path = os.path.join(BASE_PATH, "model_" + ts + ".csv")
     df_result.to_csv(result_path, index=False)    
-    print(df_result)
\ No newline at end of file
+    print(df_result)
+    fitOccupancy(df_result)
\ No newline at end of file
@@ -2,6 +2,7 @@ import os
 import pandas as pd
 import matplotlib.pyplot as plt
 import numpy as np
+from powerTrace import readPowerTrace, kernelWindow
 
 MEASUREMENTS_PATH = os.path.join(os.getcwd(), "..", "power_model", "measurements")
 OUTPUT_PATH = os.path.join(os.getcwd(), "out")    
@@ -47,7 +48,7 @@ def plotPowerDrawAll(files, out):
 
     # Read data from files and cleanup
     for file in files:
-        df = pd.read_csv(file)
+        df = readPowerTrace(file)
         df["timestamp"] = (df["timestamp"] - df["timestamp"][0]) / 1000000000
         for col in devices:
             df[col] = df[col] / 1000000
@@ -95,6 +96,12 @@ def plotPowerDrawAll(files, out):
     max_end = max([max(df["timestamp"]) for df in dfs_power.values()])
     stop_x = average_end - (stop_wait / 1000)
 
+    # Exact kernel window from the profiling markers when every trace has them
+    windows = [kernelWindow(df) for df in dfs_power.values()]
+    if all(window is not None for window in windows):
+        start_x = np.average([window[0] for window in windows])
+        stop_x = np.average([window[1] for window in windows])
+
     # Integrate Power
     idle = calculateIdle(average_df, measure_device_name, start, stop)
     idle_box = abs(stop - stop_x) * idle
@@ -146,7 +153,7 @@ def plotPowerEasy(files, out):
 
     # Read data from files and cleanup
     for file in files:
-        df = pd.read_csv(file)
+        df = readPowerTrace(file)
         df["timestamp"] = (df["timestamp"] - df["timestamp"][0]) / 1000000000
         for col in devices:
             df[col] = df[col] / 1000000
@@ -190,6 +197,12 @@ def plotPowerEasy(files, out):
     max_end = max([max(df["timestamp"]) for df in dfs_power.values()])
     stop_x = average_end - (stop_wait / 1000)
 
+    # Exact kernel window from the profiling markers when every trace has them
+    windows = [kernelWindow(df) for df in dfs_power.values()]
+    if all(window is not None for window in windows):
+        start_x = np.average([window[0] for window in windows])
+        stop_x = np.average([window[1] for window in windows])
+
     power2 = integratePower(average_df, measure_device_name, start_x, stop_x) / (stop_x - start_x)
     
     ax[0].axhline(y = power2, color = 'tab:blue', label = 'energy/s', linewidth=2)
@@ -213,7 +226,8 @@ def plotPowerEasy(files, out):
 
 def getPowerFiles(name, count):
     base_path = os.path.join(MEASUREMENTS_PATH, name)
-    power_files = [os.path.join(base_path, f"power_{i}.csv") for i in range(count)]
+    power_files = [os.path.join(base_path, f"power_{i}.mbt") for i in range(count)]
+    power_files = [file if os.path.exists(file) else file[:-4] + ".csv" for file in power_files]
     counter_file = os.path.join(base_path, f"counter.csv")
     return power_files, counter_file
 
@@ -2,6 +2,7 @@ import os
 import pandas as pd
 import matplotlib.pyplot as plt
 import numpy as np
+from powerTrace import readPowerTrace
 
 MEASUREMENTS_PATH = os.path.join(os.getcwd(), "..", "power_model", "measurements")
 OUTPUT_PATH = os.path.join(os.getcwd(), "out")    
@@ -12,7 +13,7 @@ def plotPowerDrawAll(files, out):
     colors = ["tab:blue", "tab:orange", "tab:green", "tab:red"]
 
     for file in files:
-        df = pd.read_csv(file)
+        df = readPowerTrace(file)
         df["timestamp"] = (df["timestamp"] - df["timestamp"][0]) / 1000000000
         for col in col_names:
             df[col] = df[col] / 1000000
@@ -55,7 +56,7 @@ def plotPowerDrawAllBox(files, out, boxes = 20):
     devices = ["power:device=" + str(i) for i in range(4)]    
 
     for file in files:        
-        df = pd.read_csv(file)  
+        df = readPowerTrace(file)  
         df["timestamp"] = (df["timestamp"] - df["timestamp"][0]) / 1000000000
         for col in devices:
             df[col] = df[col] / 1000000
@@ -99,7 +100,8 @@ def plotPowerDrawAllBox(files, out, boxes = 20):
 
 def getPowerFiles(name, count):
     base_path = os.path.join(MEASUREMENTS_PATH, name)
-    power_files = [os.path.join(base_path, f"power_{i}.csv") for i in range(count)]
+    power_files = [os.path.join(base_path, f"power_{i}.mbt") for i in range(count)]
+    power_files = [file if os.path.exists(file) else file[:-4] + ".csv" for file in power_files]
     counter_file = os.path.join(base_path, f"counter.csv")
     return power_files, counter_file
 
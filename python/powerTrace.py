@@ -0,0 +1,71 @@
+import numpy as np
+import pandas as pd
+
+TRACE_MAGIC = b"MBTRACE\0"
+
+# struct PowerTraceHeader in power_model/src/power-wrappers/microbench-power-trace.h
+HEADER_TYPE = np.dtype([
+    ("magic", "S8"),
+    ("version", "<u4"),
+    ("device_count", "<u4"),
+    ("sample_count", "<u8"),
+    ("timestamp_unit", "S8"),
+    ("power_unit", "S8"),
+    ("clock", "S32"),
+    ("names_offset", "<u8"),
+    ("names_size", "<u8"),
+    ("timestamps_offset", "<u8"),
+    ("power_offset", "<u8"),
+    ("markers_offset", "<u8"),
+    ("marker_count", "<u8"),
+])
+
+MARKER_TYPE = np.dtype([("timestamp", "<i8"), ("label", "S24")])
+
+def isPowerTrace(path):
+    with open(path, "rb") as file:
+        return file.read(len(TRACE_MAGIC)) == TRACE_MAGIC
+
+def readPowerTrace(path):
+    """Load a power_*.csv or binary power_*.mbt as a DataFrame with the columns id,timestamp,power:<device>[,marker]"""
+    if not isPowerTrace(path):
+        return pd.read_csv(path)
+
+    data = np.memmap(path, dtype=np.uint8, mode="r")
+    header = np.frombuffer(bytes(data[:HEADER_TYPE.itemsize]).ljust(HEADER_TYPE.itemsize, b"\0"), dtype=HEADER_TYPE)[0]
+    devices = int(header["device_count"])
+    samples = int(header["sample_count"])
+
+    names_start = int(header["names_offset"])
+    names = bytes(data[names_start:names_start + int(header["names_size"])]).decode().split("\n")[:devices]
+
+    timestamps_start = int(header["timestamps_offset"])
+    timestamps = data[timestamps_start:timestamps_start + samples * 8].view(np.int64)
+    power_start = int(header["power_offset"])
+    power = data[power_start:power_start + devices * samples * 8].view(np.uint64).reshape(devices, samples)
+
+    df = pd.DataFrame({"id": np.arange(samples), "timestamp": timestamps})
+    for i, name in enumerate(names):
+        df["power:" + name] = power[i]
+
+    # Version 2: markers are attached to the first sample at or after their timestamp
+    if int(header["version"]) >= 2 and int(header["marker_count"]) > 0:
+        markers_start = int(header["markers_offset"])
+        markers = data[markers_start:markers_start + int(header["marker_count"]) * MARKER_TYPE.itemsize].view(MARKER_TYPE)
+        labels = [[] for _ in range(samples)]
+        for marker in markers:
+            sample = min(int(np.searchsorted(timestamps, marker["timestamp"])), samples - 1)
+            labels[sample].append(marker["label"].decode())
+        df["marker"] = [";".join(label) if label else np.nan for label in labels]
+    return df
+
+def kernelWindow(df):
+    """First kernel start and last kernel end in the timestamp unit of the DataFrame, None without markers"""
+    if "marker" not in df.columns:
+        return None
+    markers = df[df["marker"].notna()]
+    starts = markers[markers["marker"].str.contains("kernel_start")]["timestamp"]
+    ends = markers[markers["marker"].str.contains("kernel_end")]["timestamp"]
+    if len(starts) == 0 or len(ends) == 0:
+        return None
+    return min(starts), max(ends)